@@ -0,0 +1,440 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#include "batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Quantos ciclos cada instância roda sozinha antes de checar se os PCs voltaram a coincidir
+#define REJOIN_INTERVAL 8
+
+// Um vetor com uma posição por instância. As extensões de vetor do GCC viram SSE2 no x86-64 e NEON
+// no ARM, e operações escalares onde não houver SIMD. Tudo fica em 16 bytes: os campos de 16 bits
+// são tratados em duas metades.
+typedef uint8_t lane_u8 __attribute__((vector_size(EMULATOR_BATCH_LANES)));
+typedef uint8_t half_u8 __attribute__((vector_size(EMULATOR_BATCH_LANES/2)));
+typedef uint16_t half_u16 __attribute__((vector_size(EMULATOR_BATCH_LANES)));
+
+// Os arrays só têm o alinhamento do malloc, então as cargas são feitas com memcpy
+static inline lane_u8 load_u8(const uint8_t* p) {
+	lane_u8 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void store_u8(uint8_t* p, lane_u8 v) {
+	memcpy(p, &v, sizeof(v));
+}
+
+// p[k] = v[k] onde live[k] é 0xFF; onde é 0, p[k] fica como está
+static inline void put_u8(uint8_t* p, lane_u8 v, lane_u8 live) {
+	store_u8(p, (v & live) | (load_u8(p) & ~live));
+}
+
+// p[k] = base + v[k], também só onde live[k] é 0xFF
+static inline void set_u16(uint16_t* p, uint16_t base, lane_u8 v, lane_u8 live) {
+	for (uint8_t h=0; h<2; h++) {
+		half_u8 part, live_part;
+		half_u16 old;
+		memcpy(&part, (const uint8_t*)&v + h*sizeof(part), sizeof(part));
+		memcpy(&live_part, (const uint8_t*)&live + h*sizeof(live_part), sizeof(live_part));
+		memcpy(&old, p + h*EMULATOR_BATCH_LANES/2, sizeof(old));
+
+		const half_u16 mask = (half_u16)(__builtin_convertvector(live_part, half_u16) != 0);
+		const half_u16 wide = __builtin_convertvector(part, half_u16) + base;
+		const half_u16 merged = (wide & mask) | (old & ~mask);
+		memcpy(p + h*EMULATOR_BATCH_LANES/2, &merged, sizeof(merged));
+	}
+}
+
+// p[k] += v[k] (pra deixar uma posição parada, basta o v dela ser 0)
+static inline void add_u16(uint16_t* p, lane_u8 v) {
+	for (uint8_t h=0; h<2; h++) {
+		half_u8 part;
+		half_u16 wide;
+		memcpy(&part, (const uint8_t*)&v + h*sizeof(part), sizeof(part));
+		memcpy(&wide, p + h*EMULATOR_BATCH_LANES/2, sizeof(wide));
+
+		wide += __builtin_convertvector(part, half_u16);
+		memcpy(p + h*EMULATOR_BATCH_LANES/2, &wide, sizeof(wide));
+	}
+}
+
+static const lane_u8 zero = {0};
+
+// Percorre todas as instâncias, inclusive as de sobra, um vetor por vez
+#define LANES(k) for (size_t k=0; k<batch->padded; k+=EMULATOR_BATCH_LANES)
+
+// 0xFF nas instâncias que ainda rodam, 0 nas que falharam
+static inline lane_u8 live_lanes(const struct emulator_batch* batch, size_t k) {
+	return (lane_u8)(load_u8((const uint8_t*)batch->faulted+k) == 0);
+}
+
+int emulator_batch_init(struct emulator_batch* batch, const struct emulator* prototype, size_t count) {
+	memset(batch, 0, sizeof(struct emulator_batch));
+
+	if (count == 0) {
+		return 1;
+	}
+
+	batch->count = count;
+	batch->padded = (count + EMULATOR_BATCH_LANES-1) / EMULATOR_BATCH_LANES * EMULATOR_BATCH_LANES;
+	batch->cycles_per_frame = prototype->cycles_per_frame;
+
+	batch->pc = calloc(batch->padded, sizeof(uint16_t));
+	batch->i = calloc(batch->padded, sizeof(uint16_t));
+	for (uint8_t r=0; r<16; r++) {
+		batch->v[r] = calloc(batch->padded, sizeof(uint8_t));
+	}
+	batch->delay_timer = calloc(batch->padded, sizeof(uint8_t));
+	batch->sound_timer = calloc(batch->padded, sizeof(uint8_t));
+	batch->keys = calloc(batch->padded, sizeof(uint16_t));
+	batch->faulted = calloc(batch->padded, sizeof(bool));
+	batch->instances = calloc(count, sizeof(struct emulator));
+
+	bool failed = batch->pc == NULL || batch->i == NULL || batch->delay_timer == NULL ||
+		batch->sound_timer == NULL || batch->keys == NULL || batch->faulted == NULL ||
+		batch->instances == NULL;
+	for (uint8_t r=0; r<16; r++) {
+		failed |= batch->v[r] == NULL;
+	}
+	if (failed) {
+		emulator_batch_free(batch);
+		return 1;
+	}
+
+	for (size_t k=0; k<count; k++) {
+		batch->instances[k] = *prototype;
+		// O caminho escalar usa só o interpretador, e o profiler e o trace do protótipo não são
+		// das instâncias
+		batch->instances[k]._jit = NULL;
+#ifdef EMULATOR_PROFILE
+		batch->instances[k]._profile = NULL;
+#endif
+#ifdef EMULATOR_TRACE
+		batch->instances[k]._trace = NULL;
+#endif
+
+		batch->pc[k] = prototype->_pc;
+		batch->i[k] = prototype->_i;
+		for (uint8_t r=0; r<16; r++) {
+			batch->v[r][k] = prototype->_v[r];
+		}
+		batch->delay_timer[k] = prototype->_delay_timer;
+		batch->sound_timer[k] = prototype->_sound_timer;
+		batch->keys[k] = prototype->keys;
+	}
+
+	return 0;
+}
+
+void emulator_batch_free(struct emulator_batch* batch) {
+	free(batch->pc);
+	free(batch->i);
+	for (uint8_t r=0; r<16; r++) {
+		free(batch->v[r]);
+	}
+	free(batch->delay_timer);
+	free(batch->sound_timer);
+	free(batch->keys);
+	free(batch->faulted);
+	free(batch->instances);
+
+	memset(batch, 0, sizeof(struct emulator_batch));
+}
+
+static void lane_to_instance(struct emulator_batch* batch, size_t k) {
+	struct emulator* emulator = &batch->instances[k];
+
+	emulator->_pc = batch->pc[k];
+	emulator->_i = batch->i[k];
+	for (uint8_t r=0; r<16; r++) {
+		emulator->_v[r] = batch->v[r][k];
+	}
+	emulator->_delay_timer = batch->delay_timer[k];
+	emulator->_sound_timer = batch->sound_timer[k];
+	emulator->keys = batch->keys[k];
+}
+
+static void instance_to_lane(struct emulator_batch* batch, size_t k) {
+	const struct emulator* emulator = &batch->instances[k];
+
+	batch->pc[k] = emulator->_pc;
+	batch->i[k] = emulator->_i;
+	for (uint8_t r=0; r<16; r++) {
+		batch->v[r][k] = emulator->_v[r];
+	}
+	batch->delay_timer[k] = emulator->_delay_timer;
+	batch->sound_timer[k] = emulator->_sound_timer;
+}
+
+void emulator_batch_sync(struct emulator_batch* batch) {
+	for (size_t k=0; k<batch->count; k++) {
+		lane_to_instance(batch, k);
+	}
+}
+
+// Fx33 e Fx55 são as únicas instruções que escrevem na memória. O que elas escrevem pode ser
+// diferente em cada instância, e se for código, o opcode no mesmo PC também.
+static void mark_writes(struct emulator_batch* batch, const struct emulator* emulator) {
+	if (emulator->_pc >= MEMORY_SIZE-1) {
+		return;
+	}
+
+	const uint16_t opcode = emulator->_memory[emulator->_pc] << 8 | emulator->_memory[emulator->_pc + 1];
+	uint16_t len;
+
+	switch (opcode & 0xF0FF) {
+	case 0xF033: len = 3; break;
+	case 0xF055: len = ((opcode >> 8) & 0x000F) + 1; break;
+	default: return;
+	}
+
+	for (uint16_t addr=emulator->_i; addr<emulator->_i+len && addr<MEMORY_SIZE; addr++) {
+		batch->divergent[addr] = true;
+	}
+}
+
+static void run_lane(struct emulator_batch* batch, size_t k, size_t n) {
+	struct emulator* emulator = &batch->instances[k];
+
+	lane_to_instance(batch, k);
+
+	for (; n>0; n--) {
+		mark_writes(batch, emulator);
+
+		if (emulator_cycle(emulator) != 0) {
+			batch->faulted[k] = true;
+			batch->faults++;
+			break;
+		}
+	}
+
+	instance_to_lane(batch, k);
+}
+
+// Todas as instâncias que não falharam estão no mesmo PC? lead fica com a primeira delas.
+static bool same_pc(const struct emulator_batch* batch, size_t* lead) {
+	size_t first = 0;
+	while (first < batch->count && batch->faulted[first]) {
+		first++;
+	}
+	if (first == batch->count) {
+		return false;
+	}
+
+	const uint16_t pc = batch->pc[first];
+
+	uint16_t differ = 0;
+	for (size_t k=first+1; k<batch->count; k++) {
+		differ |= (batch->pc[k] ^ pc) & (batch->faulted[k] ? 0 : 0xFFFF);
+	}
+
+	*lead = first;
+	return differ == 0 && pc < MEMORY_SIZE-1;
+}
+
+// E com o mesmo opcode nele? Só precisa olhar cada instância se alguém já escreveu ali.
+static bool same_opcode(const struct emulator_batch* batch, size_t lead, uint16_t* opcode) {
+	const uint16_t pc = batch->pc[lead];
+
+	const uint8_t* memory = batch->instances[lead]._memory;
+	*opcode = memory[pc] << 8 | memory[pc + 1];
+
+	if (batch->divergent[pc] || batch->divergent[pc + 1]) {
+		for (size_t k=lead+1; k<batch->count; k++) {
+			if (batch->faulted[k]) {
+				continue;
+			}
+			memory = batch->instances[k]._memory;
+			if ((memory[pc] << 8 | memory[pc + 1]) != *opcode) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Executa uma instrução em todas as instâncias de uma vez. Retorna false se ela não tem versão
+// vetorial (mexe em memória, tela, pilha, teclas ou pode falhar), e aí nada foi feito. As que
+// falharam ficam de fora: cada escrita passa pela máscara LIVE.
+static bool step_vector(struct emulator_batch* batch, uint16_t opcode) {
+	const uint8_t x = (opcode >> 8) & 0x000F;
+	const uint8_t y = (opcode >> 4) & 0x000F;
+	const uint8_t n = opcode & 0x000F;
+	const uint8_t kk = opcode & 0x00FF;
+	const uint16_t nnn = opcode & 0x0FFF;
+
+	uint16_t* const pc = batch->pc;
+	uint16_t* const i = batch->i;
+	uint8_t* const vx = batch->v[x];
+	uint8_t* const vy = batch->v[y];
+	uint8_t* const vf = batch->v[0xF];
+	uint8_t* const dt = batch->delay_timer;
+	uint8_t* const st = batch->sound_timer;
+
+#define LIVE live_lanes(batch, k)
+
+	// As comparações dão 0 ou 0xFF em cada posição; o AND com 2 vira o pulo extra dos skips
+	switch (opcode & 0xF000) {
+	case 0x1000:
+		LANES(k) set_u16(pc+k, nnn, zero, LIVE);
+		return true;
+	case 0x3000:
+		LANES(k) add_u16(pc+k, (2 + ((lane_u8)(load_u8(vx+k) == kk) & 2)) & LIVE);
+		return true;
+	case 0x4000:
+		LANES(k) add_u16(pc+k, (2 + ((lane_u8)(load_u8(vx+k) != kk) & 2)) & LIVE);
+		return true;
+	case 0x5000:
+		if (n != 0) {
+			return false;
+		}
+		LANES(k) add_u16(pc+k, (2 + ((lane_u8)(load_u8(vx+k) == load_u8(vy+k)) & 2)) & LIVE);
+		return true;
+	case 0x6000:
+		LANES(k) put_u8(vx+k, zero + kk, LIVE);
+		break;
+	case 0x7000:
+		LANES(k) put_u8(vx+k, load_u8(vx+k) + kk, LIVE);
+		break;
+	// VF é escrito antes e Vx/Vy lidos de novo depois, na mesma ordem do interpretador, pra valer
+	// também quando x ou y é F
+	case 0x8000:
+		switch (n) {
+		case 0x0: LANES(k) put_u8(vx+k, load_u8(vy+k), LIVE); break;
+		case 0x1: LANES(k) put_u8(vx+k, load_u8(vx+k) | load_u8(vy+k), LIVE); break;
+		case 0x2: LANES(k) put_u8(vx+k, load_u8(vx+k) & load_u8(vy+k), LIVE); break;
+		case 0x3: LANES(k) put_u8(vx+k, load_u8(vx+k) ^ load_u8(vy+k), LIVE); break;
+		case 0x4:
+			LANES(k) {
+				const lane_u8 a = load_u8(vx+k);
+				const lane_u8 sum = a + load_u8(vy+k);
+				put_u8(vf+k, (lane_u8)(sum < a) & 1, LIVE);
+				put_u8(vx+k, load_u8(vx+k) + load_u8(vy+k), LIVE);
+			}
+			break;
+		case 0x5:
+			LANES(k) {
+				put_u8(vf+k, (lane_u8)(load_u8(vx+k) > load_u8(vy+k)) & 1, LIVE);
+				put_u8(vx+k, load_u8(vx+k) - load_u8(vy+k), LIVE);
+			}
+			break;
+		case 0x6:
+			LANES(k) {
+				put_u8(vf+k, load_u8(vx+k) & 1, LIVE);
+				put_u8(vx+k, load_u8(vx+k) >> 1, LIVE);
+			}
+			break;
+		case 0x7:
+			LANES(k) {
+				put_u8(vf+k, (lane_u8)(load_u8(vy+k) > load_u8(vx+k)) & 1, LIVE);
+				put_u8(vx+k, load_u8(vy+k) - load_u8(vx+k), LIVE);
+			}
+			break;
+		case 0xE:
+			LANES(k) {
+				put_u8(vf+k, load_u8(vx+k) >> 7, LIVE);
+				put_u8(vx+k, load_u8(vx+k) << 1, LIVE);
+			}
+			break;
+		default:
+			return false;
+		}
+		break;
+	case 0x9000:
+		if (n != 0) {
+			return false;
+		}
+		LANES(k) add_u16(pc+k, (2 + ((lane_u8)(load_u8(vx+k) != load_u8(vy+k)) & 2)) & LIVE);
+		return true;
+	case 0xA000:
+		LANES(k) set_u16(i+k, nnn, zero, LIVE);
+		break;
+	case 0xB000:
+		LANES(k) set_u16(pc+k, nnn, load_u8(batch->v[0]+k), LIVE);
+		return true;
+	case 0xF000:
+		switch (kk) {
+		case 0x07: LANES(k) put_u8(vx+k, load_u8(dt+k), LIVE); break;
+		case 0x15: LANES(k) put_u8(dt+k, load_u8(vx+k), LIVE); break;
+		case 0x18: LANES(k) put_u8(st+k, load_u8(vx+k), LIVE); break;
+		case 0x1E: LANES(k) add_u16(i+k, load_u8(vx+k) & LIVE); break;
+		default:
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	LANES(k) add_u16(pc+k, (zero + 2) & LIVE);
+	return true;
+
+#undef LIVE
+}
+
+void emulator_batch_step(struct emulator_batch* batch, size_t n) {
+	while (n > 0) {
+		uint16_t opcode;
+		size_t lead;
+		const bool together = same_pc(batch, &lead);
+
+		if (together && same_opcode(batch, lead, &opcode) && step_vector(batch, opcode)) {
+			n--;
+			continue;
+		}
+
+		// Juntas, só essa instrução roda separada. Divergiram: cada uma roda um pedaço sozinha,
+		// já que até os PCs voltarem a coincidir não há o que vetorizar.
+		size_t chunk = 1;
+		if (!together) {
+			chunk = n < REJOIN_INTERVAL ? n : REJOIN_INTERVAL;
+		}
+
+		for (size_t k=0; k<batch->count; k++) {
+			if (!batch->faulted[k]) {
+				run_lane(batch, k, chunk);
+			}
+		}
+
+		n -= chunk;
+	}
+}
+
+void emulator_batch_tick(struct emulator_batch* batch) {
+	for (size_t k=0; k<batch->count; k++) {
+		batch->instances[k].draw_flag = false;
+	}
+
+	emulator_batch_step(batch, batch->cycles_per_frame);
+
+	for (size_t k=0; k<batch->count; k++) {
+		batch->instances[k].beep_flag = batch->sound_timer[k] == 1;
+	}
+
+	// Instâncias que falharam ficam paradas, timers inclusive
+	LANES(k) {
+		const lane_u8 running = (lane_u8)(load_u8((const uint8_t*)batch->faulted+k) == 0);
+		const lane_u8 dt = load_u8(batch->delay_timer+k);
+		const lane_u8 st = load_u8(batch->sound_timer+k);
+		store_u8(batch->delay_timer+k, dt - ((lane_u8)(dt != 0) & running & 1));
+		store_u8(batch->sound_timer+k, st - ((lane_u8)(st != 0) & running & 1));
+	}
+}
@@ -0,0 +1,77 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "emulator.h"
+
+// Quantas instâncias cabem num vetor de bytes (SSE2/NEON). Os arrays são arredondados pra cima
+// nesse múltiplo, e as instâncias de sobra só existem pra não precisar de laço de sobra.
+#define EMULATOR_BATCH_LANES 16
+
+// Várias cópias da mesma ROM rodando em passo único. Enquanto todas (menos as que falharam)
+// estão no mesmo PC e a instrução mexe só em registradores, ela roda uma vez pra todas, em vetor.
+// Quando os PCs divergem (ou a instrução mexe em memória, tela, pilha ou teclas), cada instância
+// roda sozinha pelo emulator_cycle.
+struct emulator_batch {
+	size_t count;
+	size_t padded; // count arredondado pra múltiplo de EMULATOR_BATCH_LANES
+
+	uint8_t cycles_per_frame;
+
+	// Estado quente em struct-of-arrays: o registrador r da instância k fica em v[r][k]
+	uint16_t* pc;
+	uint16_t* i;
+	uint8_t* v[16];
+	uint8_t* delay_timer;
+	uint8_t* sound_timer;
+
+	// Escrito por quem usa, antes de cada passo
+	uint16_t* keys;
+
+	// Instâncias que falharam param onde estão; as outras seguem, em vetor ou não
+	bool* faulted;
+	size_t faults;
+
+	// Memória, tela, pilha e gerador de números aleatórios continuam numa struct emulator por
+	// instância (todas começam com a semente do protótipo; use emulator_seed nelas pra variar). Os
+	// registradores dela só valem depois do emulator_batch_sync.
+	struct emulator* instances;
+
+	// Bytes que alguma instância já escreveu (Fx33/Fx55) e que podem ser diferentes entre elas
+	bool divergent[MEMORY_SIZE];
+};
+
+// Cria count cópias de prototype. Retorna 1 se count for zero ou faltar memória.
+int emulator_batch_init(struct emulator_batch* batch, const struct emulator* prototype, size_t count);
+void emulator_batch_free(struct emulator_batch* batch);
+
+// Roda n ciclos em todas as instâncias.
+void emulator_batch_step(struct emulator_batch* batch, size_t n);
+
+// O mesmo que emulator_tick em cada instância: cycles_per_frame ciclos e os timers.
+void emulator_batch_tick(struct emulator_batch* batch);
+
+// Copia os registradores de volta pras instâncias, pra ler o estado completo delas.
+void emulator_batch_sync(struct emulator_batch* batch);
+
+#endif
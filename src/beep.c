@@ -3,43 +3,88 @@
 #include <SDL3/SDL.h>
 #include <math.h>
 
-#define BEEP_DURATION_MS 200
 #define BEEP_FREQ 750
+#define BEEP_VOLUME 0.5f
+
+// Uma volta do seno, indexada pelos bits altos da fase
+#define WAVETABLE_BITS 8
+#define WAVETABLE_SIZE (1 << WAVETABLE_BITS)
+
+// Amostras geradas por vez dentro do callback
+#define CHUNK 512
 
 static SDL_AudioStream* stream = NULL;
 
-void beep_init(void) {
-	SDL_AudioSpec wantSpec = {
-		.format   = SDL_AUDIO_F32,   // 32-bit float samples
-		.channels = 1,               // mono
-		.freq     = 44100            // sample rate
-    	};
+static float wavetable[WAVETABLE_SIZE];
 
-	stream = SDL_OpenAudioDeviceStream(
-		SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, 
-		&wantSpec, NULL, 0
-    	);
+// Com 32 bits, a fase dá a volta sozinha no fim do ciclo
+static uint32_t phase = 0;
+static uint32_t phase_step = 0;
 
-	SDL_ResumeAudioStreamDevice(stream);
+// Amostras de tom que ainda faltam. A thread da emulação troca o valor e o callback desconta o que
+// gerou; se os dois se cruzarem, o valor novo ganha.
+static SDL_AtomicInt gate;
+
+static void SDLCALL generate(void* userdata, SDL_AudioStream* audio, int additional_amount, int total_amount) {
+	(void)userdata;
+	(void)total_amount;
+
+	static float buffer[CHUNK];
+	int samples = additional_amount / (int)sizeof(float);
+
+	while (samples > 0) {
+		const int count = samples < CHUNK ? samples : CHUNK;
+
+		const int left = SDL_GetAtomicInt(&gate);
+		const int tone = left < count ? left : count;
+		for (int i=0; i<tone; i++) {
+			buffer[i] = wavetable[phase >> (32 - WAVETABLE_BITS)];
+			phase += phase_step;
+		}
+		for (int i=tone; i<count; i++) {
+			buffer[i] = 0.0f;
+		}
+		if (tone < count) {
+			// Em silêncio, o próximo tom começa do zero do seno, sem estalo
+			phase = 0;
+		}
+		if (tone > 0) {
+			SDL_CompareAndSwapAtomicInt(&gate, left, left - tone);
+		}
+
+		SDL_PutAudioStreamData(audio, buffer, count * (int)sizeof(float));
+		samples -= count;
+	}
 }
 
-void beep_play(void) {
-	int sr = 44100;
-	int samples = (BEEP_DURATION_MS * sr) / 1000;
-	float *buf = SDL_malloc(sizeof(float) * samples);
+void beep_init(void) {
+	for (int i=0; i<WAVETABLE_SIZE; i++) {
+		wavetable[i] = BEEP_VOLUME * sinf(2.0f * 3.14159265f * i / WAVETABLE_SIZE);
+	}
+	phase_step = (uint32_t)(((uint64_t)BEEP_FREQ << 32) / BEEP_RATE);
+	SDL_SetAtomicInt(&gate, 0);
+
+	SDL_AudioSpec spec = {
+		.format   = SDL_AUDIO_F32, // 32-bit float samples
+		.channels = 1,             // mono
+		.freq     = BEEP_RATE,
+	};
 
-	for (int i = 0; i < samples; i++) {
-		float t = (float)i / sr;
-		buf[i] = sinf(2.0f * 3.14159265f * BEEP_FREQ * t);
+	stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, generate, NULL);
+	if (stream == NULL) {
+		SDL_Log("Couldn't open audio: %s", SDL_GetError());
+		return;
 	}
+	SDL_ResumeAudioStreamDevice(stream);
+}
 
-	SDL_PutAudioStreamData(stream, buf, samples * sizeof(float));
-	SDL_free(buf);
+void beep_gate(uint8_t ticks) {
+	SDL_SetAtomicInt(&gate, ticks * BEEP_RATE / 60);
 }
 
 void beep_quit(void) {
 	if (stream) {
 		SDL_DestroyAudioStream(stream);
 		stream = NULL;
-    	}
-}
\ No newline at end of file
+	}
+}
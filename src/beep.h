@@ -1,8 +1,17 @@
 #ifndef BEEP_H
 #define BEEP_H
 
+#include <stdint.h>
+
+// O som é gerado o tempo todo pelo callback do SDL, e o timer de som do CHIP-8 só abre e fecha a
+// saída: cada tick do timer vale exatamente BEEP_RATE/60 amostras de tom.
+#define BEEP_RATE 44100
+
 void beep_init(void);
-void beep_play(void);
+
+// O tom toca pelos próximos ticks/60 s, trocando o que ainda faltava do anterior (0 corta já).
+void beep_gate(uint8_t ticks);
+
 void beep_quit(void);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,201 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+// Micro-benchmarks: cada ROM sintética é um laço que exercita uma família de instruções. Imprime
+// uma linha JSON por ROM e modo, com ns por instrução (média, desvio padrão e mínimo das rodadas).
+
+// clock_gettime
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "emulator.h"
+
+#ifdef EMULATOR_JIT
+#define ENGINE "jit"
+#elif defined(EMULATOR_THREADED)
+#define ENGINE "threaded"
+#else
+#define ENGINE "switch"
+#endif
+
+#define RUNS 15
+#define INSTRUCTIONS_PER_RUN 2000000
+
+// O máximo que cabe no cycles_per_frame, pra o emulator_tick medir mais instruções que timers
+#define CYCLES_PER_FRAME 255
+
+// O maior programa das medições, em instruções
+#define MAX_PROGRAM_LENGTH 16
+
+struct bench {
+	const char* name;
+	const uint16_t* program;
+	size_t length;
+};
+
+// Todas começam em 0x200 e voltam pra lá com 1200
+
+static const uint16_t alu[] = {
+	0x6105, 0x6207, 0x8014, 0x8125, 0x8236, 0x8347, 0x845E, 0x8561,
+	0x8672, 0x8783, 0x8894, 0x8910, 0x7A01, 0x1200,
+};
+
+// Uns pulam, outros não, e o V0 muda a cada volta. O enchimento é 8000 (LD V0, V0): avança o PC
+// sem mudar nada, então o laço nunca para
+static const uint16_t skips[] = {
+	0x3000, 0x8000, 0x3001, 0x4000, 0x4001, 0x8000, 0x5010, 0x8000,
+	0x9010, 0x7001, 0x1200,
+};
+
+// 0x200: CALL 0x206; CALL 0x206; JP 0x200; 0x206: RET
+static const uint16_t call_ret[] = {
+	0x2206, 0x2206, 0x1200, 0x00EE,
+};
+
+// Sprites da fonte, com colisão e passando da borda
+static const uint16_t draw[] = {
+	0xA000, 0xD01F, 0x703B, 0x711D, 0xD015, 0xF229, 0xD125, 0x1200,
+};
+
+// Fx55 e Fx65 de todos os registradores
+static const uint16_t bulk_memory[] = {
+	0xA300, 0xFF55, 0xA310, 0xFF65, 0x7001, 0x1200,
+};
+
+static const uint16_t bcd[] = {
+	0xA300, 0xF033, 0xF133, 0xF233, 0xF333, 0x7007, 0x1200,
+};
+
+// SUPER-CHIP: sprites de 16x16 cruzando as palavras da linha e as três rolagens. Volta pra 0x202,
+// senão o 00FF apagaria a tela a cada volta.
+static const uint16_t hires_scroll[] = {
+	0x00FF, 0xA050, 0xD010, 0x00C1, 0x00FB, 0x00FC, 0x7009, 0x7105, 0x1202,
+};
+
+#define BENCH(program) { #program, program, sizeof(program)/sizeof(program[0]) }
+
+static const struct bench benches[] = {
+	BENCH(alu),
+	BENCH(skips),
+	BENCH(call_ret),
+	BENCH(draw),
+	BENCH(bulk_memory),
+	BENCH(bcd),
+	BENCH(hires_scroll),
+};
+
+static struct emulator emulator;
+
+// Como a ROM carregada por um arquivo, com a fonte e o programa em 0x200
+static void setup(const struct bench* bench) {
+	uint8_t rom[2*MAX_PROGRAM_LENGTH];
+	for (size_t j=0; j<bench->length; j++) {
+		rom[2*j] = bench->program[j] >> 8;
+		rom[2*j + 1] = bench->program[j] & 0xFF;
+	}
+
+	emulator_quit(&emulator);
+	emulator_init_from_buffer(&emulator, rom, 2*bench->length, 0);
+	emulator.cycles_per_frame = CYCLES_PER_FRAME;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Retornam quantas instruções rodaram de fato
+static size_t run_cycles(size_t instructions) {
+	for (size_t j=0; j<instructions; j++) {
+		if (emulator_cycle(&emulator) != 0) {
+			fprintf(stderr, "Error: benchmark program faulted.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	return instructions;
+}
+
+static size_t run_ticks(size_t instructions) {
+	const size_t frames = instructions/CYCLES_PER_FRAME;
+	for (size_t j=0; j<frames; j++) {
+		if (emulator_tick(&emulator) != 0) {
+			fprintf(stderr, "Error: benchmark program faulted.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	return frames*CYCLES_PER_FRAME;
+}
+
+static void measure(const struct bench* bench, const char* mode, size_t (*run)(size_t)) {
+	double ns[RUNS];
+
+	setup(bench);
+
+	// Uma rodada pra aquecer cache, preditor e o JIT
+	run(INSTRUCTIONS_PER_RUN);
+
+	double sum = 0;
+	double min = INFINITY;
+	for (int r=0; r<RUNS; r++) {
+		const double start = now();
+		const size_t executed = run(INSTRUCTIONS_PER_RUN);
+		ns[r] = (now() - start) * 1e9 / executed;
+
+		sum += ns[r];
+		if (ns[r] < min) {
+			min = ns[r];
+		}
+	}
+
+	const double mean = sum / RUNS;
+	double variance = 0;
+	for (int r=0; r<RUNS; r++) {
+		variance += (ns[r] - mean) * (ns[r] - mean);
+	}
+	variance /= RUNS - 1;
+
+	printf("{\"engine\":\"%s\",\"bench\":\"%s\",\"mode\":\"%s\",\"runs\":%d,\"instructions\":%d,"
+		"\"ns_per_instr\":%.3f,\"stddev\":%.3f,\"min\":%.3f,\"state_hash\":\"%016llx\"}\n",
+		ENGINE, bench->name, mode, RUNS, INSTRUCTIONS_PER_RUN, mean, sqrt(variance), min,
+		(unsigned long long)emulator_state_hash(&emulator));
+}
+
+int main(int argc, char* argv[]) {
+	// Com argumentos, roda só as ROMs com esses nomes
+	for (size_t b=0; b<sizeof(benches)/sizeof(benches[0]); b++) {
+		bool selected = argc < 2;
+		for (int arg=1; arg<argc; arg++) {
+			selected |= strcmp(argv[arg], benches[b].name) == 0;
+		}
+		if (!selected) {
+			continue;
+		}
+
+		measure(&benches[b], "cycle", run_cycles);
+		measure(&benches[b], "tick", run_ticks);
+	}
+
+	emulator_quit(&emulator);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,229 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#include "c8emu.h"
+#include "emulator.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Os códigos públicos são os mesmos do núcleo, pra passar direto sem tradução
+#define SAME_VALUE(public, core) typedef char check_##public[(int)(public) == (int)(core) ? 1 : -1]
+SAME_VALUE(C8EMU_OK, EMULATOR_OK);
+SAME_VALUE(C8EMU_ERROR_OPEN, EMULATOR_ERROR_OPEN);
+SAME_VALUE(C8EMU_ERROR_READ, EMULATOR_ERROR_READ);
+SAME_VALUE(C8EMU_ERROR_TOO_BIG, EMULATOR_ERROR_TOO_BIG);
+SAME_VALUE(C8EMU_FAULT_NONE, EMULATOR_FAULT_NONE);
+SAME_VALUE(C8EMU_FAULT_PC_OUT_OF_BOUNDS, EMULATOR_FAULT_PC_OUT_OF_BOUNDS);
+SAME_VALUE(C8EMU_FAULT_STACK_UNDERFLOW, EMULATOR_FAULT_STACK_UNDERFLOW);
+SAME_VALUE(C8EMU_FAULT_STACK_OVERFLOW, EMULATOR_FAULT_STACK_OVERFLOW);
+SAME_VALUE(C8EMU_FAULT_UNKNOWN_OPCODE, EMULATOR_FAULT_UNKNOWN_OPCODE);
+SAME_VALUE(C8EMU_FAULT_SPRITE_OUT_OF_BOUNDS, EMULATOR_FAULT_SPRITE_OUT_OF_BOUNDS);
+SAME_VALUE(C8EMU_FAULT_INVALID_KEY, EMULATOR_FAULT_INVALID_KEY);
+SAME_VALUE(C8EMU_FAULT_INVALID_FONT, EMULATOR_FAULT_INVALID_FONT);
+SAME_VALUE(C8EMU_FAULT_MEMORY_OUT_OF_BOUNDS, EMULATOR_FAULT_MEMORY_OUT_OF_BOUNDS);
+SAME_VALUE(C8EMU_HIRES_WIDTH, EMULATOR_HIRES_WIDTH);
+SAME_VALUE(C8EMU_HIRES_HEIGHT, EMULATOR_HIRES_HEIGHT);
+#undef SAME_VALUE
+
+struct c8emu {
+	struct emulator emulator;
+
+	uint64_t frame;
+	bool faulted;
+	uint64_t fault_frame;
+};
+
+// O buffer do snapshot: o do núcleo e o número do quadro
+#define SNAPSHOT_SIZE (sizeof(struct emulator_snapshot) + sizeof(uint64_t))
+
+int c8emu_create(c8emu** out, const uint8_t* rom, size_t size, uint64_t seed) {
+	*out = NULL;
+
+	c8emu* emu = malloc(sizeof(c8emu));
+	if (emu == NULL) {
+		return C8EMU_ERROR_MEMORY;
+	}
+
+	const int error = emulator_init_from_buffer(&emu->emulator, rom, size, seed);
+	if (error != EMULATOR_OK) {
+		free(emu);
+		return error;
+	}
+	emu->frame = 0;
+	emu->faulted = false;
+	emu->fault_frame = 0;
+
+	*out = emu;
+	return C8EMU_OK;
+}
+
+int c8emu_create_from_file(c8emu** out, const char* path, uint64_t seed) {
+	*out = NULL;
+
+	struct emulator_rom rom;
+	const int error = emulator_rom_map(&rom, path);
+	if (error != EMULATOR_OK) {
+		return error;
+	}
+
+	const int result = c8emu_create(out, rom.data, rom.size, seed);
+	emulator_rom_unmap(&rom);
+	return result;
+}
+
+void c8emu_destroy(c8emu* emu) {
+	if (emu == NULL) {
+		return;
+	}
+	emulator_quit(&emu->emulator);
+	free(emu);
+}
+
+int c8emu_reset(c8emu* emu, const uint8_t* rom, size_t size, uint64_t seed) {
+	const int error = emulator_reset(&emu->emulator, rom, size, seed);
+	if (error != EMULATOR_OK) {
+		return error;
+	}
+	emu->frame = 0;
+	emu->faulted = false;
+	return C8EMU_OK;
+}
+
+void c8emu_set_cycles_per_frame(c8emu* emu, uint8_t cycles) {
+	emu->emulator.cycles_per_frame = cycles == 0 ? 1 : cycles;
+}
+
+int c8emu_run_frame(c8emu* emu, uint16_t keys) {
+	if (emu->faulted) {
+		return C8EMU_ERROR_FAULT;
+	}
+
+	emu->emulator.keys = keys;
+	if (emulator_tick(&emu->emulator) != 0) {
+		emu->faulted = true;
+		emu->fault_frame = emu->frame;
+		return C8EMU_ERROR_FAULT;
+	}
+
+	emu->frame++;
+	return C8EMU_OK;
+}
+
+int c8emu_fault(const c8emu* emu, struct c8emu_fault* fault) {
+	if (!emu->faulted) {
+		return 0;
+	}
+
+	fault->kind = emu->emulator.fault.kind;
+	fault->pc = emu->emulator.fault.pc;
+	fault->opcode = emu->emulator.fault.opcode;
+	fault->frame = emu->fault_frame;
+	return 1;
+}
+
+uint64_t c8emu_frame(const c8emu* emu) {
+	return emu->frame;
+}
+
+unsigned c8emu_width(const c8emu* emu) {
+	return emulator_width(&emu->emulator);
+}
+
+unsigned c8emu_height(const c8emu* emu) {
+	return emulator_height(&emu->emulator);
+}
+
+void c8emu_screen(const c8emu* emu, uint8_t pixels[C8EMU_HIRES_WIDTH*C8EMU_HIRES_HEIGHT]) {
+	const uint8_t width = emulator_width(&emu->emulator);
+	const uint8_t height = emulator_height(&emu->emulator);
+
+	for (uint8_t y=0; y<height; y++) {
+		for (uint8_t x=0; x<width; x++) {
+			pixels[y*width + x] = emulator_pixel(&emu->emulator, x, y);
+		}
+	}
+}
+
+int c8emu_pixel(const c8emu* emu, unsigned x, unsigned y) {
+	if (x >= emulator_width(&emu->emulator) || y >= emulator_height(&emu->emulator)) {
+		return 0;
+	}
+	return emulator_pixel(&emu->emulator, x, y);
+}
+
+int c8emu_drew(const c8emu* emu) {
+	return emu->emulator.draw_flag;
+}
+
+int c8emu_beep(const c8emu* emu) {
+	return emu->emulator.beep_flag;
+}
+
+uint64_t c8emu_screen_hash(const c8emu* emu) {
+	return emulator_screen_hash(&emu->emulator);
+}
+
+uint64_t c8emu_state_hash(const c8emu* emu) {
+	return emulator_state_hash(&emu->emulator);
+}
+
+size_t c8emu_snapshot_size(void) {
+	return SNAPSHOT_SIZE;
+}
+
+// O buffer de quem chama pode estar desalinhado: o snapshot passa por uma cópia local
+void c8emu_snapshot(const c8emu* emu, void* buffer) {
+	struct emulator_snapshot snapshot;
+	emulator_snapshot(&emu->emulator, &snapshot);
+
+	memcpy(buffer, &snapshot, sizeof(struct emulator_snapshot));
+	memcpy((uint8_t*)buffer + sizeof(struct emulator_snapshot), &emu->frame, sizeof(uint64_t));
+}
+
+int c8emu_restore(c8emu* emu, const void* buffer, size_t size) {
+	if (size != SNAPSHOT_SIZE) {
+		return C8EMU_ERROR_SNAPSHOT;
+	}
+
+	struct emulator_snapshot snapshot;
+	memcpy(&snapshot, buffer, sizeof(struct emulator_snapshot));
+	if (emulator_restore(&emu->emulator, &snapshot) != 0) {
+		return C8EMU_ERROR_SNAPSHOT;
+	}
+	memcpy(&emu->frame, (const uint8_t*)buffer + sizeof(struct emulator_snapshot), sizeof(uint64_t));
+	emu->faulted = false;
+	return C8EMU_OK;
+}
+
+const char* c8emu_error_string(int error) {
+	switch (error) {
+		case C8EMU_ERROR_MEMORY:
+			return "out of memory";
+		case C8EMU_ERROR_SNAPSHOT:
+			return "snapshot from a different version";
+		case C8EMU_ERROR_FAULT:
+			return "the emulated program faulted";
+		default:
+			return emulator_error_string(error);
+	}
+}
+
+const char* c8emu_fault_string(int kind) {
+	return emulator_fault_string(kind);
+}
@@ -0,0 +1,118 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef C8EMU_H
+#define C8EMU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// API da libc8emu, pra embutir o emulador em outro programa. O c8emu é opaco: o struct emulator
+// por trás pode mudar sem recompilar quem usa a biblioteca.
+//
+// Não existe estado global, então um processo pode ter quantas instâncias quiser. Cada uma só
+// pode ser usada por uma thread de cada vez. Nenhuma função sai do programa nem escreve nada: os
+// erros voltam como C8EMU_ERROR_* e uma falha do programa emulado para só a instância dele.
+
+#ifdef __GNUC__
+#define C8EMU_API __attribute__((visibility("default")))
+#else
+#define C8EMU_API
+#endif
+
+// A tela é 64x32, ou 128x64 depois do 00FF do SUPER-CHIP
+#define C8EMU_WIDTH 64
+#define C8EMU_HEIGHT 32
+#define C8EMU_HIRES_WIDTH 128
+#define C8EMU_HIRES_HEIGHT 64
+
+typedef struct c8emu c8emu;
+
+enum c8emu_error {
+	C8EMU_OK = 0,
+	C8EMU_ERROR_OPEN,     // O errno diz por quê
+	C8EMU_ERROR_READ,
+	C8EMU_ERROR_TOO_BIG,  // A ROM não cabe na memória
+	C8EMU_ERROR_MEMORY,   // Sem memória pra instância
+	C8EMU_ERROR_SNAPSHOT, // Snapshot de outra versão da biblioteca
+	C8EMU_ERROR_FAULT,    // O programa emulado falhou; o c8emu_fault diz onde
+};
+
+enum c8emu_fault_kind {
+	C8EMU_FAULT_NONE = 0,
+	C8EMU_FAULT_PC_OUT_OF_BOUNDS,
+	C8EMU_FAULT_STACK_UNDERFLOW,
+	C8EMU_FAULT_STACK_OVERFLOW,
+	C8EMU_FAULT_UNKNOWN_OPCODE,
+	C8EMU_FAULT_SPRITE_OUT_OF_BOUNDS,
+	C8EMU_FAULT_INVALID_KEY,
+	C8EMU_FAULT_INVALID_FONT,        // Fx29/Fx30
+	C8EMU_FAULT_MEMORY_OUT_OF_BOUNDS,
+};
+
+struct c8emu_fault {
+	int kind; // C8EMU_FAULT_*
+	uint16_t pc;
+	uint16_t opcode; // 0 se o PC estiver fora da memória
+	uint64_t frame;  // Quadros rodados antes do que falhou
+};
+
+// Cria uma instância com a ROM copiada de rom. *out fica NULL em caso de erro.
+C8EMU_API int c8emu_create(c8emu** out, const uint8_t* rom, size_t size, uint64_t seed);
+C8EMU_API int c8emu_create_from_file(c8emu** out, const char* path, uint64_t seed);
+C8EMU_API void c8emu_destroy(c8emu* emu);
+
+// Recomeça com outra ROM (ou a mesma), reaproveitando a instância. Também limpa a falha.
+C8EMU_API int c8emu_reset(c8emu* emu, const uint8_t* rom, size_t size, uint64_t seed);
+
+// Instruções por quadro, de 1 a 255 (16 por padrão, e de novo depois do c8emu_reset).
+C8EMU_API void c8emu_set_cycles_per_frame(c8emu* emu, uint8_t cycles);
+
+// Roda um quadro com as teclas em keys (um bit por tecla). Depois de uma falha, retorna
+// C8EMU_ERROR_FAULT sem rodar nada até um c8emu_reset ou c8emu_restore.
+C8EMU_API int c8emu_run_frame(c8emu* emu, uint16_t keys);
+
+// Retorna 1 e preenche *fault se a instância falhou.
+C8EMU_API int c8emu_fault(const c8emu* emu, struct c8emu_fault* fault);
+
+C8EMU_API uint64_t c8emu_frame(const c8emu* emu);
+
+// O tamanho da tela na resolução atual.
+C8EMU_API unsigned c8emu_width(const c8emu* emu);
+C8EMU_API unsigned c8emu_height(const c8emu* emu);
+
+// A tela, um byte (0 ou 1) por pixel, linha por linha: c8emu_width*c8emu_height bytes. Um buffer
+// de C8EMU_HIRES_WIDTH*C8EMU_HIRES_HEIGHT serve pras duas resoluções.
+C8EMU_API void c8emu_screen(const c8emu* emu, uint8_t pixels[C8EMU_HIRES_WIDTH*C8EMU_HIRES_HEIGHT]);
+C8EMU_API int c8emu_pixel(const c8emu* emu, unsigned x, unsigned y);
+
+// Se o último quadro desenhou algo e se ele deve tocar o bipe.
+C8EMU_API int c8emu_drew(const c8emu* emu);
+C8EMU_API int c8emu_beep(const c8emu* emu);
+
+C8EMU_API uint64_t c8emu_screen_hash(const c8emu* emu);
+C8EMU_API uint64_t c8emu_state_hash(const c8emu* emu);
+
+// Snapshots em buffers de c8emu_snapshot_size() bytes, sem alinhamento especial.
+C8EMU_API size_t c8emu_snapshot_size(void);
+C8EMU_API void c8emu_snapshot(const c8emu* emu, void* buffer);
+C8EMU_API int c8emu_restore(c8emu* emu, const void* buffer, size_t size);
+
+C8EMU_API const char* c8emu_error_string(int error);
+C8EMU_API const char* c8emu_fault_string(int kind);
+
+#endif
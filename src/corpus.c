@@ -0,0 +1,550 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+// Roda todas as ROMs de um diretório com cada combinação de semente e roteiro de teclas, em todos
+// os núcleos do processador, e imprime um relatório JSON: uma linha por execução, na ordem das
+// combinações, e um resumo no fim.
+//
+// Cada combinação é uma tarefa com o próprio struct emulator. As tarefas são divididas em blocos
+// entre as threads no começo; quem termina o seu bloco rouba do começo do bloco das outras, então
+// uma ROM lenta não deixa o resto das threads paradas.
+
+// clock_gettime, sysconf e dirent
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "emulator.h"
+#include "input_script.h"
+
+#define DEFAULT_FRAMES 600
+
+// Os pedaços da linha de execução. Uma tarefa por ROM, semente e roteiro.
+struct task {
+	size_t rom;
+	size_t seed;
+	size_t input;
+};
+
+struct result {
+	int error; // EMULATOR_OK, ou o que o emulator_init_from_buffer retornou (e a tarefa nem rodou)
+	uint64_t frames;
+	uint64_t cycles;
+	struct emulator_fault fault; // kind EMULATOR_FAULT_NONE se terminou
+	uint64_t screen_hash;
+	uint64_t state_hash;
+	double seconds;
+};
+
+// Deque de Chase-Lev sem push: os índices das tarefas são fixos e só a faixa [top, bottom) muda.
+// A dona tira do fim e as outras threads roubam do começo.
+struct deque {
+	int64_t top;
+	int64_t bottom;
+	char _pad[64]; // Cada deque na sua linha de cache
+};
+
+struct corpus {
+	// Cada ROM é mapeada uma vez e todas as tarefas dela partem das mesmas páginas
+	char** roms;
+	struct emulator_rom* images;
+	size_t rom_count;
+
+	uint64_t* seeds;
+	size_t seed_count;
+
+	// Com nenhum --input, uma execução sem teclas (input_names[0] == NULL)
+	struct input_script* inputs;
+	const char** input_names;
+	size_t input_count;
+
+	uint64_t frames;
+	uint8_t cycles_per_frame; // 0: o padrão do emulador
+
+	struct task* tasks;
+	struct result* results;
+	size_t task_count;
+
+	struct deque* deques;
+	size_t thread_count;
+};
+
+#define EMPTY (-1)
+#define ABORT (-2)
+
+static inline void show_usage(const char* argv0) {
+	printf("%s <rom_dir> [options]\n", argv0);
+	printf("  --seeds LIST          seeds to run each ROM with, e.g. 0,1,2 or 0-15 (default 0)\n");
+	printf("  --input FILE          scripted input to run each ROM with, as in c8emu-headless; may be\n");
+	printf("                        repeated (default: no keys)\n");
+	printf("  --frames N            run N frames per ROM (default %d)\n", DEFAULT_FRAMES);
+	printf("  --cycles-per-frame N  instructions per frame, 1-255 (default 16)\n");
+	printf("  --threads N           worker threads (default: one per online processor)\n");
+}
+
+static uint64_t parse_number(const char* option, const char* text) {
+	char* end;
+	const unsigned long long value = strtoull(text, &end, 0);
+
+	if (*text == '\0' || *end != '\0' || *text == '-') {
+		fprintf(stderr, "Error: %s expects a non-negative number, got \"%s\".\n", option, text);
+		exit(EXIT_FAILURE);
+	}
+
+	return value;
+}
+
+static void* grow(void* array, size_t count, size_t size) {
+	// Dobra quando count chega numa potência de 2
+	if (count == 0 || (count & (count - 1)) == 0) {
+		array = realloc(array, (count == 0 ? 1 : 2*count) * size);
+		if (array == NULL) {
+			perror("Failed to allocate memory");
+			exit(EXIT_FAILURE);
+		}
+	}
+	return array;
+}
+
+// "0,3,5-9"
+static void parse_seeds(struct corpus* corpus, const char* text) {
+	const char* c = text;
+	for (;;) {
+		char* end;
+		const unsigned long long first = strtoull(c, &end, 0);
+		unsigned long long last = first;
+		if (end == c || *c == '-') {
+			fprintf(stderr, "Error: invalid seed list \"%s\".\n", text);
+			exit(EXIT_FAILURE);
+		}
+		c = end;
+
+		if (*c == '-') {
+			last = strtoull(c + 1, &end, 0);
+			if (end == c + 1 || last < first) {
+				fprintf(stderr, "Error: invalid seed range in \"%s\".\n", text);
+				exit(EXIT_FAILURE);
+			}
+			c = end;
+		}
+
+		for (unsigned long long seed=first; ; seed++) {
+			corpus->seeds = grow(corpus->seeds, corpus->seed_count, sizeof(uint64_t));
+			corpus->seeds[corpus->seed_count++] = seed;
+			if (seed == last) {
+				break;
+			}
+		}
+
+		if (*c == '\0') {
+			break;
+		}
+		if (*c != ',') {
+			fprintf(stderr, "Error: invalid seed list \"%s\".\n", text);
+			exit(EXIT_FAILURE);
+		}
+		c++;
+	}
+}
+
+static int compare_names(const void* a, const void* b) {
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Os arquivos comuns de dir que cabem na memória, em ordem alfabética, já mapeados
+static void scan_roms(struct corpus* corpus, const char* dir) {
+	DIR* d = opendir(dir);
+	if (d == NULL) {
+		perror("Failed to open ROM directory");
+		exit(EXIT_FAILURE);
+	}
+
+	const struct dirent* entry;
+	while ((entry = readdir(d)) != NULL) {
+		if (entry->d_name[0] == '.') {
+			continue;
+		}
+
+		const size_t length = strlen(dir) + 1 + strlen(entry->d_name) + 1;
+		char* path = malloc(length);
+		if (path == NULL) {
+			perror("Failed to allocate memory");
+			exit(EXIT_FAILURE);
+		}
+		snprintf(path, length, "%s/%s", dir, entry->d_name);
+
+		struct stat info;
+		if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+			free(path);
+			continue;
+		}
+		if (info.st_size > MEMORY_SIZE-MEMORY_START) {
+			fprintf(stderr, "Skipping %s: ROM file too big.\n", path);
+			free(path);
+			continue;
+		}
+
+		corpus->roms = grow(corpus->roms, corpus->rom_count, sizeof(char*));
+		corpus->roms[corpus->rom_count++] = path;
+	}
+
+	closedir(d);
+
+	qsort(corpus->roms, corpus->rom_count, sizeof(char*), compare_names);
+
+	corpus->images = calloc(corpus->rom_count > 0 ? corpus->rom_count : 1, sizeof(struct emulator_rom));
+	if (corpus->images == NULL) {
+		perror("Failed to allocate memory");
+		exit(EXIT_FAILURE);
+	}
+	for (size_t rom=0; rom<corpus->rom_count; rom++) {
+		const int error = emulator_rom_map(&corpus->images[rom], corpus->roms[rom]);
+		if (error != EMULATOR_OK) {
+			fprintf(stderr, "Error: %s: %s.\n", corpus->roms[rom], emulator_error_string(error));
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run_task(const struct corpus* corpus, const struct task* task, struct result* result) {
+	const double start = now();
+
+	struct emulator* emulator = malloc(sizeof(struct emulator));
+	if (emulator == NULL) {
+		perror("Failed to allocate memory");
+		exit(EXIT_FAILURE);
+	}
+	memset(result, 0, sizeof(struct result));
+
+	const struct emulator_rom* image = &corpus->images[task->rom];
+	result->error = emulator_init_from_buffer(emulator, image->data, image->size, corpus->seeds[task->seed]);
+	if (result->error != EMULATOR_OK) {
+		free(emulator);
+		result->seconds = now() - start;
+		return;
+	}
+	if (corpus->cycles_per_frame != 0) {
+		emulator->cycles_per_frame = corpus->cycles_per_frame;
+	}
+
+	// O roteiro é compartilhado; só a posição é de cada tarefa
+	struct input_script script = corpus->inputs[task->input];
+	script.next = 0;
+
+	for (uint64_t frame=0; frame<corpus->frames; frame++) {
+		emulator->keys = input_script_keys(&script, frame, emulator->keys);
+
+		// Uma falha encerra só esta tarefa
+		if (emulator_tick(emulator) != 0) {
+			result->fault = emulator->fault;
+			break;
+		}
+
+		result->frames++;
+		result->cycles += emulator->cycles_per_frame;
+	}
+
+	result->screen_hash = emulator_screen_hash(emulator);
+	result->state_hash = emulator_state_hash(emulator);
+
+	emulator_quit(emulator);
+	free(emulator);
+
+	result->seconds = now() - start;
+}
+
+// Índice da próxima tarefa da própria deque, ou EMPTY
+static int64_t take(struct deque* deque) {
+	const int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, b, __ATOMIC_SEQ_CST);
+	const int64_t t = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+
+	if (t > b) {
+		__atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+		return EMPTY;
+	}
+
+	// A última: disputa com quem estiver roubando
+	if (t == b) {
+		int64_t expected = t;
+		const bool won = __atomic_compare_exchange_n(&deque->top, &expected, t + 1, false,
+			__ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+		__atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+		return won ? b : EMPTY;
+	}
+
+	return b;
+}
+
+// Índice roubado do começo de outra deque, EMPTY ou ABORT (outra thread levou primeiro)
+static int64_t steal(struct deque* deque) {
+	int64_t t = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+	const int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_SEQ_CST);
+
+	if (t >= b) {
+		return EMPTY;
+	}
+
+	return __atomic_compare_exchange_n(&deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED) ?
+		t : ABORT;
+}
+
+struct worker {
+	struct corpus* corpus;
+	size_t id;
+	pthread_t thread;
+};
+
+static void* work(void* arg) {
+	const struct worker* worker = arg;
+	struct corpus* corpus = worker->corpus;
+
+	for (;;) {
+		int64_t task = take(&corpus->deques[worker->id]);
+
+		// Sem nada próprio: procura nas outras. Como nenhuma tarefa nova aparece, uma volta inteira
+		// sem achar nada (e sem perder disputas) quer dizer que acabou.
+		bool contended = false;
+		for (size_t k=1; task == EMPTY && k<corpus->thread_count; k++) {
+			task = steal(&corpus->deques[(worker->id + k) % corpus->thread_count]);
+			if (task == ABORT) {
+				contended = true;
+				task = EMPTY;
+			}
+		}
+
+		if (task == EMPTY) {
+			if (contended) {
+				continue;
+			}
+			break;
+		}
+
+		run_task(corpus, &corpus->tasks[task], &corpus->results[task]);
+	}
+
+	return NULL;
+}
+
+static void print_string(const char* text) {
+	putchar('"');
+	for (const char* c=text; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			printf("\\%c", *c);
+		} else if ((unsigned char)*c < 0x20) {
+			printf("\\u%04x", *c);
+		} else {
+			putchar(*c);
+		}
+	}
+	putchar('"');
+}
+
+static void print_result(const struct corpus* corpus, const struct task* task, const struct result* result) {
+	printf("{\"rom\":");
+	print_string(corpus->roms[task->rom]);
+	printf(",\"seed\":%llu,\"input\":", (unsigned long long)corpus->seeds[task->seed]);
+	if (corpus->input_names[task->input] != NULL) {
+		print_string(corpus->input_names[task->input]);
+	} else {
+		printf("null");
+	}
+	printf(",\"error\":");
+	if (result->error != EMULATOR_OK) {
+		print_string(emulator_error_string(result->error));
+	} else {
+		printf("null");
+	}
+	printf(",\"frames\":%llu,\"cycles\":%llu,\"fault\":", (unsigned long long)result->frames,
+		(unsigned long long)result->cycles);
+	if (result->fault.kind != EMULATOR_FAULT_NONE) {
+		printf("{\"kind\":");
+		print_string(emulator_fault_string(result->fault.kind));
+		printf(",\"pc\":\"0x%03X\",\"opcode\":\"%04X\"}", result->fault.pc, result->fault.opcode);
+	} else {
+		printf("null");
+	}
+	printf(",\"screen_hash\":\"%016llx\",\"state_hash\":\"%016llx\",\"ms\":%.3f}\n",
+		(unsigned long long)result->screen_hash, (unsigned long long)result->state_hash,
+		result->seconds * 1e3);
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2 || strcmp(argv[1], "--help")==0 || strcmp(argv[1], "-h")==0) {
+		show_usage(argv[0]);
+		return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	static struct corpus corpus;
+	corpus.frames = DEFAULT_FRAMES;
+
+	const long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	corpus.thread_count = processors > 0 ? processors : 1;
+
+	for (int arg=2; arg<argc; arg++) {
+		if (arg + 1 >= argc) {
+			fprintf(stderr, "Error: unknown option or missing value: %s\n", argv[arg]);
+			return EXIT_FAILURE;
+		}
+
+		const char* option = argv[arg];
+		const char* value = argv[++arg];
+
+		if (strcmp(option, "--seeds") == 0) {
+			corpus.seed_count = 0;
+			parse_seeds(&corpus, value);
+		} else if (strcmp(option, "--input") == 0) {
+			corpus.inputs = grow(corpus.inputs, corpus.input_count, sizeof(struct input_script));
+			corpus.input_names = grow(corpus.input_names, corpus.input_count, sizeof(char*));
+			corpus.inputs[corpus.input_count] = (struct input_script){ NULL, 0, 0 };
+			input_script_load(&corpus.inputs[corpus.input_count], value);
+			corpus.input_names[corpus.input_count] = value;
+			corpus.input_count++;
+		} else if (strcmp(option, "--frames") == 0) {
+			corpus.frames = parse_number(option, value);
+		} else if (strcmp(option, "--cycles-per-frame") == 0) {
+			const uint64_t n = parse_number(option, value);
+			if (n == 0 || n > 255) {
+				fprintf(stderr, "Error: cycles per frame amount must be between 1-255.\n");
+				return EXIT_FAILURE;
+			}
+			corpus.cycles_per_frame = n;
+		} else if (strcmp(option, "--threads") == 0) {
+			corpus.thread_count = parse_number(option, value);
+			if (corpus.thread_count == 0) {
+				fprintf(stderr, "Error: --threads must be at least 1.\n");
+				return EXIT_FAILURE;
+			}
+		} else {
+			fprintf(stderr, "Error: unknown option: %s\n", option);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (corpus.seed_count == 0) {
+		corpus.seeds = grow(corpus.seeds, 0, sizeof(uint64_t));
+		corpus.seeds[corpus.seed_count++] = 0;
+	}
+	if (corpus.input_count == 0) {
+		corpus.inputs = grow(corpus.inputs, 0, sizeof(struct input_script));
+		corpus.input_names = grow(corpus.input_names, 0, sizeof(char*));
+		corpus.inputs[0] = (struct input_script){ NULL, 0, 0 };
+		corpus.input_names[0] = NULL;
+		corpus.input_count = 1;
+	}
+
+	scan_roms(&corpus, argv[1]);
+	if (corpus.rom_count == 0) {
+		fprintf(stderr, "Error: no ROMs found in %s.\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	corpus.task_count = corpus.rom_count * corpus.seed_count * corpus.input_count;
+	corpus.tasks = malloc(corpus.task_count * sizeof(struct task));
+	corpus.results = calloc(corpus.task_count, sizeof(struct result));
+	if (corpus.thread_count > corpus.task_count) {
+		corpus.thread_count = corpus.task_count;
+	}
+	corpus.deques = calloc(corpus.thread_count, sizeof(struct deque));
+	struct worker* workers = calloc(corpus.thread_count, sizeof(struct worker));
+	if (corpus.tasks == NULL || corpus.results == NULL || corpus.deques == NULL || workers == NULL) {
+		perror("Failed to allocate memory");
+		return EXIT_FAILURE;
+	}
+
+	size_t t = 0;
+	for (size_t rom=0; rom<corpus.rom_count; rom++) {
+		for (size_t seed=0; seed<corpus.seed_count; seed++) {
+			for (size_t input=0; input<corpus.input_count; input++) {
+				corpus.tasks[t++] = (struct task){ rom, seed, input };
+			}
+		}
+	}
+
+	// Blocos contíguos: as execuções da mesma ROM tendem a ficar na mesma thread
+	for (size_t w=0; w<corpus.thread_count; w++) {
+		corpus.deques[w].top = corpus.task_count * w / corpus.thread_count;
+		corpus.deques[w].bottom = corpus.task_count * (w + 1) / corpus.thread_count;
+	}
+
+	const double start = now();
+
+	for (size_t w=0; w<corpus.thread_count; w++) {
+		workers[w].corpus = &corpus;
+		workers[w].id = w;
+		if (pthread_create(&workers[w].thread, NULL, work, &workers[w]) != 0) {
+			fprintf(stderr, "Error: failed to start worker thread.\n");
+			return EXIT_FAILURE;
+		}
+	}
+	for (size_t w=0; w<corpus.thread_count; w++) {
+		pthread_join(workers[w].thread, NULL);
+	}
+
+	const double elapsed = now() - start;
+
+	size_t faults = 0;
+	size_t errors = 0;
+	uint64_t cycles = 0;
+	double busy = 0;
+	for (size_t j=0; j<corpus.task_count; j++) {
+		print_result(&corpus, &corpus.tasks[j], &corpus.results[j]);
+		faults += corpus.results[j].fault.kind != EMULATOR_FAULT_NONE;
+		errors += corpus.results[j].error != EMULATOR_OK;
+		cycles += corpus.results[j].cycles;
+		busy += corpus.results[j].seconds;
+	}
+
+	printf("{\"summary\":{\"roms\":%zu,\"tasks\":%zu,\"faults\":%zu,\"errors\":%zu,\"failed\":%zu,"
+		"\"threads\":%zu,\"cycles\":%llu,\"wall_ms\":%.3f,\"task_ms\":%.3f}}\n", corpus.rom_count,
+		corpus.task_count, faults, errors, faults + errors, corpus.thread_count, (unsigned long long)cycles, elapsed * 1e3, busy * 1e3);
+
+	for (size_t rom=0; rom<corpus.rom_count; rom++) {
+		emulator_rom_unmap(&corpus.images[rom]);
+		free(corpus.roms[rom]);
+	}
+	for (size_t input=0; input<corpus.input_count; input++) {
+		input_script_free(&corpus.inputs[input]);
+	}
+	free(corpus.roms);
+	free(corpus.images);
+	free(corpus.seeds);
+	free(corpus.inputs);
+	free(corpus.input_names);
+	free(corpus.tasks);
+	free(corpus.results);
+	free(corpus.deques);
+	free(workers);
+
+	return faults + errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
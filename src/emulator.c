@@ -15,7 +15,19 @@
 	see <https://www.gnu.org/licenses/>. 
 */
 
+// open, fstat e mmap
+#define _POSIX_C_SOURCE 200112L
+
 #include "emulator.h"
+#ifdef EMULATOR_JIT
+#include "jit.h"
+#endif
+#ifdef EMULATOR_PROFILE
+#include "profile.h"
+#endif
+#ifdef EMULATOR_TRACE
+#include "trace.h"
+#endif
 
 #include <stddef.h>
 #include <stdio.h>
@@ -24,7 +36,13 @@
 
 #include <assert.h>
 #include <string.h>
-#include <time.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define ARRAY_LEN(arr) (sizeof(arr)/sizeof(arr[0]))
 
@@ -34,17 +52,25 @@
 #define p(...)
 #endif
 
-#ifndef TEST 
-#define show_error_message(...) fprintf(stderr, __VA_ARGS__);
+#ifdef EMULATOR_STATS
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t read_ticks(void) {
+	return __rdtsc();
+}
+#elif defined(__aarch64__)
+static inline uint64_t read_ticks(void) {
+	uint64_t ticks;
+	__asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+	return ticks;
+}
 #else
-#define show_error_message(...)
-#endif
-
-static inline void unknown_opcode(uint16_t opcode) {
-	// Pra não dar aviso em testes
-	(void)opcode;
-	show_error_message("Unknown opcode: 0x%x\n", opcode);
+// Sem contador conhecido: só as contagens valem
+static inline uint64_t read_ticks(void) {
+	return 0;
 }
+#endif
+#endif
 
 static const uint8_t chip8_fontset[] = {
     0xF0, 0x90, 0x90, 0x90, 0xF0, //0
@@ -65,15 +91,51 @@ static const uint8_t chip8_fontset[] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80  //F
 };
 
-static void reset_emulator(struct emulator* emulator) {
+// Fonte grande do SUPER-CHIP (Fx30), 8x10, logo depois da pequena. O SUPER-CHIP 1.1 só tem os
+// dígitos; as letras são as do Octo.
+#define HIRES_FONT_START sizeof(chip8_fontset)
+static const uint8_t schip_fontset[] = {
+	0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, //0
+	0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, //1
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, //2
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, //3
+	0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, //4
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, //5
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, //6
+	0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, //7
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, //8
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, //9
+	0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, //A
+	0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, //B
+	0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, //C
+	0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, //D
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, //E
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  //F
+};
+
+static void load_fonts(uint8_t* memory) {
+	memcpy(memory, chip8_fontset, sizeof(chip8_fontset));
+	memcpy(memory + HIRES_FONT_START, schip_fontset, sizeof(schip_fontset));
+}
+
+// Tudo menos a memória e os caches
+static void reset_registers(struct emulator* emulator) {
 	emulator->cycles_per_frame=16;
 
-	// Limpa tudo
-	memset(emulator->_memory, 0, sizeof(emulator->_memory));
 	memset(emulator->screen, 0, sizeof(emulator->screen));
+	emulator->hires=false;
+	memset(emulator->_v, 0, sizeof(emulator->_v));
+	memset(emulator->_rpl, 0, sizeof(emulator->_rpl));
+	memset(emulator->_stack, 0, sizeof(emulator->_stack));
+#ifdef EMULATOR_STATS
+	memset(emulator->_op_count, 0, sizeof(emulator->_op_count));
+	memset(emulator->_op_ticks, 0, sizeof(emulator->_op_ticks));
+#endif
 
 	emulator->draw_flag=false;
+	emulator->beep_flag=false;
 	emulator->keys=0;
+	memset(&emulator->fault, 0, sizeof(emulator->fault));
 
 	emulator->_pc = MEMORY_START;
 	emulator->_i = 0;
@@ -81,136 +143,732 @@ static void reset_emulator(struct emulator* emulator) {
 
 	emulator->_delay_timer=0;
 	emulator->_sound_timer=0;
+}
 
-	// Carrega a fonte
-	memcpy(emulator->_memory, chip8_fontset, sizeof(chip8_fontset));
+static void reset_emulator(struct emulator* emulator) {
+	// Limpa tudo
+	memset(emulator->_memory, 0, sizeof(emulator->_memory));
+	memset(emulator->_decoded, 0, sizeof(emulator->_decoded));
+	reset_registers(emulator);
 
-	// Gambiarra? Sim. É uma porcaria de gerador de número aleatório? Sim. Alguém liga -- ainda
-	// mais considerando um sistema da década de 70? ABSOLUTAMENTE NÃO!
-	srand(time(NULL));
+	// Carrega as fontes
+	load_fonts(emulator->_memory);
 }
 
-static void load_rom(struct emulator* emulator, const char* file) {
-	FILE* rom = fopen(file, "rb");
-	if (rom == NULL) {
-		perror("Failed to open ROM");
-		exit(EXIT_FAILURE);
+#ifdef _WIN32
+// Sem mmap: lê o arquivo inteiro pra um buffer
+int emulator_rom_map(struct emulator_rom* rom, const char* path) {
+	memset(rom, 0, sizeof(struct emulator_rom));
+
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		return EMULATOR_ERROR_OPEN;
 	}
 
-	// Pega o tamanho da ROM
-	long rom_size;
-		if (fseek(rom, 0, SEEK_END) != 0 ||
-		(rom_size = ftell(rom)) < 0 ||
-		fseek(rom, 0, SEEK_SET) != 0) {
-		perror("ROM seek failed");
-		fclose(rom);
-		exit(EXIT_FAILURE);
+	long size;
+	if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) {
+		fclose(file);
+		return EMULATOR_ERROR_READ;
+	}
+	if (size > MEMORY_SIZE-MEMORY_START) {
+		fclose(file);
+		return EMULATOR_ERROR_TOO_BIG;
 	}
 
+	uint8_t* data = malloc(size > 0 ? size : 1);
+	if (data == NULL || fread(data, 1, size, file) != (size_t)size) {
+		free(data);
+		fclose(file);
+		return EMULATOR_ERROR_READ;
+	}
+	fclose(file);
 
-	if (rom_size > MEMORY_SIZE-MEMORY_START) {
-		show_error_message("ROM file too big.\n");
-		exit(EXIT_FAILURE);
+	rom->data = data;
+	rom->size = size;
+	rom->_mapping = data;
+	return EMULATOR_OK;
+}
+
+void emulator_rom_unmap(struct emulator_rom* rom) {
+	free(rom->_mapping);
+	memset(rom, 0, sizeof(struct emulator_rom));
+}
+#else
+int emulator_rom_map(struct emulator_rom* rom, const char* path) {
+	memset(rom, 0, sizeof(struct emulator_rom));
+
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return EMULATOR_ERROR_OPEN;
 	}
 
-	const size_t n = fread(emulator->_memory + MEMORY_START, 1, rom_size, rom);
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+		close(fd);
+		return EMULATOR_ERROR_READ;
+	}
+	if (info.st_size > MEMORY_SIZE-MEMORY_START) {
+		close(fd);
+		return EMULATOR_ERROR_TOO_BIG;
+	}
 
-	if (n != (size_t)rom_size) {
-		perror("Error reading ROM");
-		exit(EXIT_FAILURE);
+	// O mmap não aceita tamanho 0; uma ROM vazia fica sem mapeamento
+	if (info.st_size > 0) {
+		void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			return EMULATOR_ERROR_READ;
+		}
+		rom->data = mapping;
+		rom->_mapping = mapping;
 	}
+	rom->size = info.st_size;
 
-	fclose(rom);
+	// O mapeamento continua válido sem o descritor
+	close(fd);
+	return EMULATOR_OK;
 }
 
-void emulator_init(struct emulator* emulator, const char* rom) {
+void emulator_rom_unmap(struct emulator_rom* rom) {
+	if (rom->_mapping != NULL) {
+		munmap(rom->_mapping, rom->size);
+	}
+	memset(rom, 0, sizeof(struct emulator_rom));
+}
+#endif
+
+const char* emulator_error_string(int error) {
+	switch (error) {
+		case EMULATOR_OK:
+			return "no error";
+		case EMULATOR_ERROR_OPEN:
+			return "failed to open ROM";
+		case EMULATOR_ERROR_READ:
+			return "failed to read ROM";
+		case EMULATOR_ERROR_TOO_BIG:
+			return "ROM file too big";
+		default:
+			return "unknown error";
+	}
+}
+
+int emulator_init_from_buffer(struct emulator* emulator, const uint8_t* rom, size_t size, uint64_t seed) {
+	if (size > MEMORY_SIZE-MEMORY_START) {
+		return EMULATOR_ERROR_TOO_BIG;
+	}
+
 	reset_emulator(emulator);
-	load_rom(emulator, rom);
+	if (size > 0) {
+		memcpy(emulator->_memory + MEMORY_START, rom, size);
+	}
+	emulator_seed(emulator, seed);
+
+#ifdef EMULATOR_PROFILE
+	emulator->_profile = NULL;
+#endif
+#ifdef EMULATOR_TRACE
+	emulator->_trace = NULL;
+#endif
+	emulator->_jit = NULL;
+#ifdef EMULATOR_JIT
+	// Sem memória executável o interpretador dá conta sozinho
+	emulator->_jit = jit_create();
+#endif
+
+	return EMULATOR_OK;
 }
 
-int emulator_cycle(struct emulator* emulator) {
-	// Assert possívelmente útil
-	assert(emulator->_sp < STACK_SIZE);
+int emulator_init(struct emulator* emulator, const char* path, uint64_t seed) {
+	struct emulator_rom rom;
+	const int error = emulator_rom_map(&rom, path);
+	if (error != EMULATOR_OK) {
+		return error;
+	}
 
-	if (emulator->_pc >= MEMORY_SIZE-1) {
-		show_error_message("Error: program counter (PC) exceeds the memory amount.\n");
-		return 1;
+	emulator_init_from_buffer(emulator, rom.data, rom.size, seed);
+	emulator_rom_unmap(&rom);
+	return EMULATOR_OK;
+}
+
+void emulator_quit(struct emulator* emulator) {
+#ifdef EMULATOR_JIT
+	jit_destroy(emulator->_jit);
+#endif
+	emulator->_jit = NULL;
+}
+
+// splitmix64: espalha uma semente qualquer (até 0) pelos 128 bits do estado do xoshiro
+void emulator_seed(struct emulator* emulator, uint64_t seed) {
+	for (uint8_t j=0; j<4; j+=2) {
+		seed += 0x9E3779B97F4A7C15;
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+		z ^= z >> 31;
+
+		emulator->_rng[j] = z;
+		emulator->_rng[j + 1] = z >> 32;
 	}
+}
+
+static inline uint32_t rotl(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
 
+// xoshiro128** (https://prng.di.unimi.it/xoshiro128starstar.c)
+static inline uint32_t next_random(struct emulator* emulator) {
+	uint32_t* s = emulator->_rng;
+	const uint32_t result = rotl(s[1] * 5, 7) * 9;
+	const uint32_t t = s[1] << 9;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+
+	return result;
+}
+
+static struct emulator_decoded decode(const struct emulator* emulator, uint16_t pc) {
 	// Opcode
-	const uint16_t opcode = emulator->_memory[emulator->_pc] << 8 | emulator->_memory[emulator->_pc + 1];
+	const uint16_t opcode = emulator->_memory[pc] << 8 | emulator->_memory[pc + 1];
+
+	struct emulator_decoded d = {
+		.op  = EMULATOR_OP_UNKNOWN,
+		.x   = (opcode >> 8) & 0x000F, // Os 4 bits menores do byte alto
+		.y   = (opcode >> 4) & 0x000F, // Os 4 bits maiores do byte baixo
+		.kk  = opcode & 0x00FF, // Os 8 bits menores
+		.nnn = opcode & 0x0FFF, // Os 12 bits menores
+	};
+	const uint8_t n = opcode & 0x000F; // Os 4 bits menores
+
+	switch (opcode & 0xF000) {
+	case 0x0000:
+		switch (d.kk) {
+		case 0xE0: d.op = EMULATOR_OP_CLS; break;
+		case 0xEE: d.op = EMULATOR_OP_RET; break;
+		case 0xFB: d.op = EMULATOR_OP_SCR; break;
+		case 0xFC: d.op = EMULATOR_OP_SCL; break;
+		case 0xFD: d.op = EMULATOR_OP_EXIT; break;
+		case 0xFE: d.op = EMULATOR_OP_LOW; break;
+		case 0xFF: d.op = EMULATOR_OP_HIGH; break;
+		// Instrução ignorada
+		default:   d.op = (d.nnn & 0xFF0) == 0x0C0 ? EMULATOR_OP_SCD : EMULATOR_OP_SYS; break;
+		}
+		break;
+	case 0x1000: d.op = d.nnn == pc ? EMULATOR_OP_JP_SELF : EMULATOR_OP_JP; break;
+	case 0x2000: d.op = EMULATOR_OP_CALL; break;
+	case 0x3000: d.op = EMULATOR_OP_SE_KK; break;
+	case 0x4000: d.op = EMULATOR_OP_SNE_KK; break;
+	// Checa se o opcode está correto e o último valor é zero.
+	case 0x5000: d.op = n == 0 ? EMULATOR_OP_SE_VY : EMULATOR_OP_UNKNOWN; break;
+	case 0x6000: d.op = EMULATOR_OP_LD_KK; break;
+	case 0x7000: d.op = EMULATOR_OP_ADD_KK; break;
+	case 0x8000:
+		switch (n) { // Verifica o último bit
+		case 0x0: d.op = EMULATOR_OP_LD_VY; break;
+		case 0x1: d.op = EMULATOR_OP_OR; break;
+		case 0x2: d.op = EMULATOR_OP_AND; break;
+		case 0x3: d.op = EMULATOR_OP_XOR; break;
+		case 0x4: d.op = EMULATOR_OP_ADD_VY; break;
+		case 0x5: d.op = EMULATOR_OP_SUB; break;
+		case 0x6: d.op = EMULATOR_OP_SHR; break;
+		case 0x7: d.op = EMULATOR_OP_SUBN; break;
+		case 0xE: d.op = EMULATOR_OP_SHL; break;
+		default: break;
+		}
+		break;
+	case 0x9000: d.op = n == 0 ? EMULATOR_OP_SNE_VY : EMULATOR_OP_UNKNOWN; break;
+	case 0xA000: d.op = EMULATOR_OP_LD_I; break;
+	case 0xB000: d.op = EMULATOR_OP_JP_V0; break;
+	case 0xC000: d.op = EMULATOR_OP_RND; break;
+	case 0xD000: d.op = EMULATOR_OP_DRW; break;
+	case 0xE000:
+		switch (d.kk) {
+		case 0x9E: d.op = EMULATOR_OP_SKP; break;
+		case 0xA1: d.op = EMULATOR_OP_SKNP; break;
+		default: break;
+		}
+		break;
+	case 0xF000:
+		switch (d.kk) {
+		case 0x07: d.op = EMULATOR_OP_LD_VX_DT; break;
+		case 0x0A: d.op = EMULATOR_OP_LD_K; break;
+		case 0x15: d.op = EMULATOR_OP_LD_DT; break;
+		case 0x18: d.op = EMULATOR_OP_LD_ST; break;
+		case 0x1E: d.op = EMULATOR_OP_ADD_I; break;
+		case 0x29: d.op = EMULATOR_OP_LD_F; break;
+		case 0x30: d.op = EMULATOR_OP_LD_HF; break;
+		case 0x33: d.op = EMULATOR_OP_LD_B; break;
+		case 0x55: d.op = EMULATOR_OP_LD_MEM_VX; break;
+		case 0x65: d.op = EMULATOR_OP_LD_VX_MEM; break;
+		case 0x75: d.op = EMULATOR_OP_LD_RPL_VX; break;
+		case 0x85: d.op = EMULATOR_OP_LD_VX_RPL; break;
+		default: break;
+		}
+		break;
+	}
 
-	const uint8_t x   = (opcode >> 8) & 0x000F; // Os 4 bits menores do byte alto
-	const uint8_t y   = (opcode >> 4) & 0x000F; // Os 4 bits maiores do byte baixo
-	const uint8_t n   = opcode & 0x000F; // Os 4 bits menores
-	const uint8_t kk  = opcode & 0x00FF; // Os 8 bits menores
-	const uint16_t nnn = opcode & 0x0FFF; // Os 12 bits menores
+	// LD Vx, DT; SE/SNE Vx, kk; JP de volta: espera o delay timer chegar num valor. Fica com o kk
+	// do pulo, que é o que decide quando o laço termina.
+	if (d.op == EMULATOR_OP_LD_VX_DT && pc+5 < MEMORY_SIZE) {
+		const uint16_t skip = emulator->_memory[pc + 2] << 8 | emulator->_memory[pc + 3];
+		const uint16_t jump = emulator->_memory[pc + 4] << 8 | emulator->_memory[pc + 5];
+
+		if ((skip & 0x0F00) >> 8 == d.x && jump == (0x1000 | pc)) {
+			if ((skip & 0xF000) == 0x3000) {
+				d.op = EMULATOR_OP_WAIT_DT_SE;
+				d.kk = skip & 0x00FF;
+			} else if ((skip & 0xF000) == 0x4000) {
+				d.op = EMULATOR_OP_WAIT_DT_SNE;
+				d.kk = skip & 0x00FF;
+			}
+		}
+	}
 
 	// Asserts que só vão servir se eu for otário e tiver lascado as linhas acima
-	assert(x < 16);
-	assert(y < 16);
-	assert(n < 16);
-	assert(nnn <= 0xFFF);
+	assert(d.x < 16);
+	assert(d.y < 16);
+	assert(d.nnn <= 0xFFF);
+
+	return d;
+}
+
+bool emulator_idle_loop(const struct emulator* emulator, uint16_t pc) {
+	if (pc >= MEMORY_SIZE-1) {
+		return false;
+	}
+
+	const uint8_t op = decode(emulator, pc).op;
+	return op == EMULATOR_OP_JP_SELF || op == EMULATOR_OP_EXIT || op == EMULATOR_OP_WAIT_DT_SE ||
+		op == EMULATOR_OP_WAIT_DT_SNE;
+}
+
+// Busca a instrução no cache. Endereços ímpares (só alcançáveis via 1nnn/Bnnn) não têm entrada
+// própria e são decodificados toda vez.
+static inline struct emulator_decoded fetch(struct emulator* emulator) {
+	const uint16_t pc = emulator->_pc;
+
+	if (pc & 1) {
+		return decode(emulator, pc);
+	}
+
+	struct emulator_decoded* entry = &emulator->_decoded[pc/2];
+	if (entry->op == EMULATOR_OP_UNDECODED) {
+		*entry = decode(emulator, pc);
+	}
+	return *entry;
+}
+
+// Invalida as entradas do cache (e os blocos do JIT) que leem algum byte em [addr, addr+len).
+// Um Fx07 de laço ocioso também depende das duas instruções seguintes.
+static inline void invalidate(struct emulator* emulator, uint16_t addr, uint16_t len) {
+	const uint16_t first = addr >= 4 ? addr-4 : 0;
+	for (uint16_t e=first/2; e<=(addr+len-1)/2; e++) {
+		emulator->_decoded[e].op = EMULATOR_OP_UNDECODED;
+	}
+
+#ifdef EMULATOR_JIT
+	if (emulator->_jit != NULL) {
+		jit_invalidate(emulator->_jit, addr, len);
+	}
+#endif
+}
+
+static void record_fault(struct emulator* emulator, uint8_t kind) {
+	emulator->fault.kind = kind;
+	emulator->fault.pc = emulator->_pc;
+	emulator->fault.opcode = emulator->_pc < MEMORY_SIZE-1 ?
+		emulator->_memory[emulator->_pc] << 8 | emulator->_memory[emulator->_pc + 1] : 0;
+}
+
+static const char* const fault_names[EMULATOR_FAULT_COUNT] = {
+	[EMULATOR_FAULT_NONE] = "no fault",
+	[EMULATOR_FAULT_PC_OUT_OF_BOUNDS] = "program counter (PC) exceeds the memory amount",
+	[EMULATOR_FAULT_STACK_UNDERFLOW] = "stack pointer smaller than zero",
+	[EMULATOR_FAULT_STACK_OVERFLOW] = "stack overflow",
+	[EMULATOR_FAULT_UNKNOWN_OPCODE] = "unknown opcode",
+	[EMULATOR_FAULT_SPRITE_OUT_OF_BOUNDS] = "sprite read out of bounds",
+	[EMULATOR_FAULT_INVALID_KEY] = "invalid key code, must be smaller than 0x10",
+	[EMULATOR_FAULT_INVALID_FONT] = "invalid font character, must be smaller than 0x10",
+	[EMULATOR_FAULT_MEMORY_OUT_OF_BOUNDS] = "memory access with I exceeds the memory size",
+};
+
+const char* emulator_fault_string(int kind) {
+	return kind >= 0 && kind < EMULATOR_FAULT_COUNT ? fault_names[kind] : "unknown fault";
+}
+
+// Desenha o sprite de Dxyn em I (Dxy0: 16x16) e põe a colisão em VF. Retorna false se o sprite
+// passar do fim da memória, com as linhas até ali já desenhadas.
+//
+// Cada linha do sprite vira uma linha inteira da tela, deslocada até x0, e a colisão é um AND.
+// Na baixa resolução a tela tem exatamente 64 colunas, então a linha é uma palavra rotacionada
+// (o que já dá a volta na borda). Na alta, como no SUPER-CHIP 1.1, o que passa da borda é cortado
+// e VF conta as linhas com colisão mais as linhas cortadas embaixo.
+static inline bool draw_sprite(struct emulator* emulator, uint8_t vx, uint8_t vy, uint8_t n) {
+	const uint8_t bytes = n == 0 ? 2 : 1;
+	const uint8_t height = n == 0 ? 16 : n;
+	const uint8_t shift = 64 - 8*bytes;
+
+	uint64_t collision = 0;
+	uint8_t rows = 0;
+	bool in_bounds = true;
+
+	if (!emulator->hires) {
+		const uint8_t x0 = vx%EMULATOR_WIDTH;
+		const uint8_t y0 = vy%EMULATOR_HEIGHT;
+
+		for (uint8_t row=0; row<height; row++) {
+			const uint16_t addr = emulator->_i + bytes*row;
+			if (addr + bytes > MEMORY_SIZE) {
+				in_bounds = false;
+				break;
+			}
+			const uint64_t sprite = (uint64_t)(bytes == 2 ? emulator->_memory[addr] << 8 | emulator->_memory[addr+1] :
+				emulator->_memory[addr]) << shift;
+			const uint64_t bits = (sprite >> x0) | (sprite << ((EMULATOR_WIDTH - x0) % EMULATOR_WIDTH));
+
+			uint64_t* line = &emulator->screen[(y0+row) % EMULATOR_HEIGHT][0];
+			collision |= *line & bits;
+			*line ^= bits;
+		}
+		emulator->_v[0xF] = collision != 0;
+	} else {
+		const uint8_t x0 = vx%EMULATOR_HIRES_WIDTH;
+		const uint8_t y0 = vy%EMULATOR_HIRES_HEIGHT;
+
+		uint8_t row=0;
+		for (; row<height && y0+row<EMULATOR_HIRES_HEIGHT; row++) {
+			const uint16_t addr = emulator->_i + bytes*row;
+			if (addr + bytes > MEMORY_SIZE) {
+				in_bounds = false;
+				break;
+			}
+			const uint64_t sprite = (uint64_t)(bytes == 2 ? emulator->_memory[addr] << 8 | emulator->_memory[addr+1] :
+				emulator->_memory[addr]) << shift;
+
+			// A linha de 128 bits em duas palavras; o que passaria da coluna 127 some
+			uint64_t high, low;
+			if (x0 < 64) {
+				high = sprite >> x0;
+				low = x0 == 0 ? 0 : sprite << (64 - x0);
+			} else {
+				high = 0;
+				low = sprite >> (x0 - 64);
+			}
+
+			uint64_t* line = emulator->screen[y0+row];
+			rows += ((line[0] & high) | (line[1] & low)) != 0;
+			line[0] ^= high;
+			line[1] ^= low;
+		}
+		if (in_bounds) {
+			rows += height - row;
+		}
+		emulator->_v[0xF] = rows;
+	}
+
+	return in_bounds;
+}
+
+// 00Cn: desce a tela n linhas (da resolução atual), entrando linhas apagadas em cima
+static inline void scroll_down(struct emulator* emulator, uint8_t n) {
+	const uint8_t height = emulator_height(emulator);
+
+	memmove(emulator->screen[n], emulator->screen[0], (height - n) * sizeof(emulator->screen[0]));
+	memset(emulator->screen[0], 0, n * sizeof(emulator->screen[0]));
+}
+
+// 00FB/00FC: 4 pixels (da resolução atual) pro lado. Na baixa resolução só a primeira palavra de
+// cada linha é tela.
+static inline void scroll_right(struct emulator* emulator) {
+	if (!emulator->hires) {
+		for (uint8_t y=0; y<EMULATOR_HEIGHT; y++) {
+			emulator->screen[y][0] >>= 4;
+		}
+		return;
+	}
+
+	for (uint8_t y=0; y<EMULATOR_HIRES_HEIGHT; y++) {
+		uint64_t* line = emulator->screen[y];
+		line[1] = (line[1] >> 4) | (line[0] << 60);
+		line[0] >>= 4;
+	}
+}
+
+static inline void scroll_left(struct emulator* emulator) {
+	if (!emulator->hires) {
+		for (uint8_t y=0; y<EMULATOR_HEIGHT; y++) {
+			emulator->screen[y][0] <<= 4;
+		}
+		return;
+	}
+
+	for (uint8_t y=0; y<EMULATOR_HIRES_HEIGHT; y++) {
+		uint64_t* line = emulator->screen[y];
+		line[0] = (line[0] << 4) | (line[1] >> 60);
+		line[1] <<= 4;
+	}
+}
+
+#ifdef EMULATOR_THREADED
+// &&label e goto *ptr são extensões do GCC
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+// Executa até *budget instruções. Se uma instrução falhar, retorna 1 e deixa em *budget quantas
+// instruções ainda faltavam depois dela.
+//
+// Os handlers são escritos uma vez só. Com EMULATOR_THREADED cada um vira um label e salta direto
+// pro próximo (labels-as-values do GCC); sem, viram os cases de um switch dentro de um loop.
+static int execute(struct emulator* emulator, size_t* budget) {
+	size_t remaining = *budget;
+
+	struct emulator_decoded d;
+	uint8_t x, y, n, kk;
+	uint16_t nnn;
+
+#define FETCH() do { \
+		/* Assert possívelmente útil */ \
+		assert(emulator->_sp < STACK_SIZE); \
+		if (emulator->_pc >= MEMORY_SIZE-1) { \
+			FAULT(EMULATOR_FAULT_PC_OUT_OF_BOUNDS); \
+		} \
+		d = fetch(emulator); \
+		x = d.x; \
+		y = d.y; \
+		n = d.kk & 0x0F; \
+		kk = d.kk; \
+		nnn = d.nnn; \
+	} while (0)
+
+#ifdef EMULATOR_STATS
+	// Um tick por instrução: o fim de uma é o começo da próxima
+	uint8_t stat_op = EMULATOR_OP_COUNT;
+	uint64_t stat_start = 0;
+
+#define STAT_END() do { \
+		const uint64_t now = read_ticks(); \
+		if (stat_op != EMULATOR_OP_COUNT) { \
+			emulator->_op_count[stat_op]++; \
+			emulator->_op_ticks[stat_op] += now - stat_start; \
+		} \
+		stat_op = EMULATOR_OP_COUNT; \
+		stat_start = now; \
+	} while (0)
+#define STAT_BEGIN() stat_op = d.op
+#else
+#define STAT_END()
+#define STAT_BEGIN()
+#endif
+
+#ifdef EMULATOR_PROFILE
+#define PROFILE_STEP() do { \
+		if (emulator->_profile != NULL) { \
+			profile_step(emulator->_profile, emulator, &d); \
+		} \
+	} while (0)
+	// Os ciclos que o laço ocioso vai pular também são do orçamento do quadro
+#define PROFILE_IDLE() do { \
+		if (emulator->_profile != NULL) { \
+			profile_idle(emulator->_profile, emulator, remaining); \
+		} \
+	} while (0)
+#else
+#define PROFILE_STEP()
+#define PROFILE_IDLE()
+#endif
+
+#ifdef EMULATOR_TRACE
+	// O registro de uma instrução sai quando ela termina, com o que ela mudou. d ainda é o dela:
+	// só o FETCH da próxima o troca.
+	bool trace_pending = false;
+	uint16_t trace_pc = 0;
+	uint16_t trace_opcode = 0;
+	size_t trace_idle = 0;
+
+#define TRACE_BEGIN() do { \
+		if (emulator->_trace != NULL) { \
+			trace_pc = emulator->_pc; \
+			trace_opcode = emulator->_memory[trace_pc] << 8 | emulator->_memory[trace_pc + 1]; \
+			trace_pending = true; \
+		} \
+	} while (0)
+#define TRACE_END() do { \
+		if (trace_pending) { \
+			trace_step(emulator->_trace, emulator, trace_pc, trace_opcode, &d, trace_idle); \
+			trace_pending = false; \
+			trace_idle = 0; \
+		} \
+	} while (0)
+#define TRACE_IDLE() trace_idle = remaining
+#define TRACE_FAULT() do { \
+		if (trace_pending) { \
+			trace_fault(emulator->_trace, trace_pc, trace_opcode); \
+		} \
+	} while (0)
+#else
+#define TRACE_BEGIN()
+#define TRACE_END()
+#define TRACE_IDLE()
+#define TRACE_FAULT()
+#endif
+
+#define FAULT(kind) do { \
+		STAT_END(); \
+		TRACE_FAULT(); \
+		record_fault(emulator, kind); \
+		*budget = remaining; \
+		return 1; \
+	} while (0)
+
+	// Consome uma instrução do orçamento e busca a próxima
+#define STEP() do { \
+		STAT_END(); \
+		TRACE_END(); \
+		if (remaining == 0) { \
+			goto done; \
+		} \
+		remaining--; \
+		FETCH(); \
+		STAT_BEGIN(); \
+		PROFILE_STEP(); \
+		TRACE_BEGIN(); \
+	} while (0)
+
+#ifdef EMULATOR_THREADED
+	static const void* const targets[EMULATOR_OP_COUNT] = {
+		[EMULATOR_OP_UNDECODED] = &&target_EMULATOR_OP_UNKNOWN,
+		[EMULATOR_OP_CLS]       = &&target_EMULATOR_OP_CLS,
+		[EMULATOR_OP_RET]       = &&target_EMULATOR_OP_RET,
+		[EMULATOR_OP_SYS]       = &&target_EMULATOR_OP_SYS,
+		[EMULATOR_OP_JP]        = &&target_EMULATOR_OP_JP,
+		[EMULATOR_OP_CALL]      = &&target_EMULATOR_OP_CALL,
+		[EMULATOR_OP_SE_KK]     = &&target_EMULATOR_OP_SE_KK,
+		[EMULATOR_OP_SNE_KK]    = &&target_EMULATOR_OP_SNE_KK,
+		[EMULATOR_OP_SE_VY]     = &&target_EMULATOR_OP_SE_VY,
+		[EMULATOR_OP_LD_KK]     = &&target_EMULATOR_OP_LD_KK,
+		[EMULATOR_OP_ADD_KK]    = &&target_EMULATOR_OP_ADD_KK,
+		[EMULATOR_OP_LD_VY]     = &&target_EMULATOR_OP_LD_VY,
+		[EMULATOR_OP_OR]        = &&target_EMULATOR_OP_OR,
+		[EMULATOR_OP_AND]       = &&target_EMULATOR_OP_AND,
+		[EMULATOR_OP_XOR]       = &&target_EMULATOR_OP_XOR,
+		[EMULATOR_OP_ADD_VY]    = &&target_EMULATOR_OP_ADD_VY,
+		[EMULATOR_OP_SUB]       = &&target_EMULATOR_OP_SUB,
+		[EMULATOR_OP_SHR]       = &&target_EMULATOR_OP_SHR,
+		[EMULATOR_OP_SUBN]      = &&target_EMULATOR_OP_SUBN,
+		[EMULATOR_OP_SHL]       = &&target_EMULATOR_OP_SHL,
+		[EMULATOR_OP_SNE_VY]    = &&target_EMULATOR_OP_SNE_VY,
+		[EMULATOR_OP_LD_I]      = &&target_EMULATOR_OP_LD_I,
+		[EMULATOR_OP_JP_V0]     = &&target_EMULATOR_OP_JP_V0,
+		[EMULATOR_OP_RND]       = &&target_EMULATOR_OP_RND,
+		[EMULATOR_OP_DRW]       = &&target_EMULATOR_OP_DRW,
+		[EMULATOR_OP_SKP]       = &&target_EMULATOR_OP_SKP,
+		[EMULATOR_OP_SKNP]      = &&target_EMULATOR_OP_SKNP,
+		[EMULATOR_OP_LD_VX_DT]  = &&target_EMULATOR_OP_LD_VX_DT,
+		[EMULATOR_OP_LD_K]      = &&target_EMULATOR_OP_LD_K,
+		[EMULATOR_OP_LD_DT]     = &&target_EMULATOR_OP_LD_DT,
+		[EMULATOR_OP_LD_ST]     = &&target_EMULATOR_OP_LD_ST,
+		[EMULATOR_OP_ADD_I]     = &&target_EMULATOR_OP_ADD_I,
+		[EMULATOR_OP_LD_F]      = &&target_EMULATOR_OP_LD_F,
+		[EMULATOR_OP_LD_B]      = &&target_EMULATOR_OP_LD_B,
+		[EMULATOR_OP_LD_MEM_VX] = &&target_EMULATOR_OP_LD_MEM_VX,
+		[EMULATOR_OP_LD_VX_MEM] = &&target_EMULATOR_OP_LD_VX_MEM,
+		[EMULATOR_OP_SCD]       = &&target_EMULATOR_OP_SCD,
+		[EMULATOR_OP_SCR]       = &&target_EMULATOR_OP_SCR,
+		[EMULATOR_OP_SCL]       = &&target_EMULATOR_OP_SCL,
+		[EMULATOR_OP_EXIT]      = &&target_EMULATOR_OP_EXIT,
+		[EMULATOR_OP_LOW]       = &&target_EMULATOR_OP_LOW,
+		[EMULATOR_OP_HIGH]      = &&target_EMULATOR_OP_HIGH,
+		[EMULATOR_OP_LD_HF]     = &&target_EMULATOR_OP_LD_HF,
+		[EMULATOR_OP_LD_RPL_VX] = &&target_EMULATOR_OP_LD_RPL_VX,
+		[EMULATOR_OP_LD_VX_RPL] = &&target_EMULATOR_OP_LD_VX_RPL,
+		[EMULATOR_OP_UNKNOWN]   = &&target_EMULATOR_OP_UNKNOWN,
+		[EMULATOR_OP_JP_SELF]   = &&target_EMULATOR_OP_JP_SELF,
+		[EMULATOR_OP_WAIT_DT_SE]  = &&target_EMULATOR_OP_WAIT_DT_SE,
+		[EMULATOR_OP_WAIT_DT_SNE] = &&target_EMULATOR_OP_WAIT_DT_SNE,
+	};
+
+#define TARGET(op) target_##op:
+#define NEXT() do { \
+		STEP(); \
+		goto *targets[d.op]; \
+	} while (0)
+
+	NEXT();
+	{
+#else
+#define TARGET(op) case op:
+#define NEXT() goto next
+
+next:
+	STEP();
 
 /*#ifdef DEBUG 
 	printf("PC: 0x%04X Op: 0x%04x\n", PC, opcode);
 #endif*/
 
-	switch (opcode & 0xF000) {
-	case 0x0000:
-		switch (kk) {
-		// 00E0 => CLS. 
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#00E0
-		case 0x00E0:
-			p("CLS\n");
-
-			memset(emulator->screen, 0, sizeof(emulator->screen));
-			emulator->draw_flag=true;
-			emulator->_pc+=2;
-			break;
-		// 00EE => RET
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#00EE
-		case 0x00EE:
-			p("RET\n");
-
-			// Out-of-bounds
-			if (emulator->_sp <= 0) {
-				show_error_message("Error: stack pointer smaller than zero.\n");
-				return 1;
-			}
-			emulator->_pc=emulator->_stack[--emulator->_sp];
-			break;
-		// Instrução ignorada
-		default:
-			break;
+	switch (d.op) {
+#endif
+	// 00E0 => CLS. 
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#00E0
+	TARGET(EMULATOR_OP_CLS)
+		p("CLS\n");
+
+		memset(emulator->screen, 0, sizeof(emulator->screen));
+		emulator->draw_flag=true;
+		emulator->_pc+=2;
+		NEXT();
+	// 00EE => RET
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#00EE
+	TARGET(EMULATOR_OP_RET)
+		p("RET\n");
+
+		// Out-of-bounds
+		if (emulator->_sp <= 0) {
+			FAULT(EMULATOR_FAULT_STACK_UNDERFLOW);
 		}
-		break;
+		emulator->_pc=emulator->_stack[--emulator->_sp];
+		NEXT();
+	// Instrução ignorada
+	TARGET(EMULATOR_OP_SYS)
+		NEXT();
 	// 1nnn => JP addr
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#1nnn
-	case 0x1000:
+	TARGET(EMULATOR_OP_JP)
 		p("JP 0x%03X\n", nnn);
 
 		emulator->_pc=nnn;
-		break;
+		NEXT();
+	// 1nnn pro próprio endereço: nada muda até o fim do quadro, então termina o quadro
+	TARGET(EMULATOR_OP_JP_SELF)
+		p("JP 0x%03X (idle)\n", nnn);
+
+		PROFILE_IDLE();
+		TRACE_IDLE();
+		remaining=0;
+		NEXT();
 	// 2nnn => CALL addr
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#2nnn
-	case 0x2000:
+	TARGET(EMULATOR_OP_CALL)
 		p("CALL 0x%03X\n", nnn);
 
 		// Stack overflow
 		if ((long unsigned)emulator->_sp+1 >= ARRAY_LEN(emulator->_stack)) {
-			show_error_message("Error: stack overflow (SP=%d).\n", emulator->_sp);
-			return 1;
+			FAULT(EMULATOR_FAULT_STACK_OVERFLOW);
 		}
 
 		emulator->_stack[emulator->_sp] = emulator->_pc+2;
 		emulator->_sp++;
 		emulator->_pc=nnn;
 
-		break;
+		NEXT();
 	// 3xkk => SE Vx, byte
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#3xkk
-	case 0x3000:
+	TARGET(EMULATOR_OP_SE_KK)
 		p("SE V%X, $%02X\n", x, kk);
 
 		if (emulator->_v[x] == kk) {
@@ -219,10 +877,10 @@ int emulator_cycle(struct emulator* emulator) {
 
 		// Tem que pular a instrução pra próxima.
 		emulator->_pc+=2;
-		break;
+		NEXT();
 	// 4xkk => SNE Vx, byte
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#4xkk
-	case 0x4000:
+	TARGET(EMULATOR_OP_SNE_KK)
 		p("SNE V%X, $%02X\n", x, kk);
 
 		if (emulator->_v[x] != kk) {
@@ -231,15 +889,10 @@ int emulator_cycle(struct emulator* emulator) {
 
 		// Tem que pular a instrução pra próxima.
 		emulator->_pc+=2;
-		break;
+		NEXT();
 	// 5xy0 => SE Vx, Vy
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#5xy0
-	case 0x5000:
-		// Checa se o opcode está correto e o último valor é zero.
-		if (n != 0) {
-			unknown_opcode(opcode);
-			return 1;
-		}
+	TARGET(EMULATOR_OP_SE_VY)
 		p("SNE V%X, V%X\n", x, y);
 		if (emulator->_v[x] == emulator->_v[y]) {
 			emulator->_pc+=2;
@@ -247,392 +900,485 @@ int emulator_cycle(struct emulator* emulator) {
 
 		// Tem que pular a instrução pra próxima.
 		emulator->_pc+=2;
-		break;
+		NEXT();
 	// 6xkk => LD Vx, byte
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#6xkk
-	case 0x6000:
+	TARGET(EMULATOR_OP_LD_KK)
 		p("LD V%X, %02X\n", x, kk);
 
 		emulator->_v[x]=kk;
 		emulator->_pc+=2;
-		break;
+		NEXT();
 	// 7xkk => ADD Vx, byte
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#7xkk
-	case 0x7000:
+	TARGET(EMULATOR_OP_ADD_KK)
 		p("ADD V%X, %02X\n", x, kk);
 
 		emulator->_v[x]+=kk;
 		emulator->_pc+=2;
-		break;
-	case 0x8000:
-		switch (n) { // Verifica o último bit
-		// 8xy0 => LD Vx, Vy
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy0
-		case 0x0:
-			p("LD  V%X, V%X\n", x, y);
-			emulator->_v[x]=emulator->_v[y];
-			break;
-		// 8xy1 => OR Vx, Vy
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy1
-		case 0x1:
-			p("OR  V%X, V%X\n", x, y);
-			emulator->_v[x]|=emulator->_v[y];
-			break;
-		// 8xy2 => AND Vx, Vy
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy2
-		case 0x2:
-			p("AND  V%X, V%X\n", x, y);
-			emulator->_v[x]&=emulator->_v[y];
-			break;
-		// 8xy3 => XOR Vx, Vy
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy3
-		case 0x3:
-			p("XOR  V%X, V%X\n", x, y);
-			emulator->_v[x]^=emulator->_v[y];
-			break;
-		// 8xy4 => ADD Vx, Vy
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy4
-		case 0x4:
-			p("ADD  V%X, V%X\n", x, y);
-			const uint8_t sum = emulator->_v[x]+emulator->_v[y];
-
-			// Deu carry
-			if (sum < emulator->_v[x]) {
-				emulator->_v[0xF]=1;
-			} else {
-				emulator->_v[0xF]=0;
-			}
-
-			emulator->_v[x]+=emulator->_v[y];
-			break;
-		// 8xy5 => SUB Vx, Vy
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy5
-		case 0x5:
-			p("SUB  V%X, V%X\n", x, y);
-
-			// Deu carry
-			if (emulator->_v[x] > emulator->_v[y]) {
-				emulator->_v[0xF]=1;
-			} else {
-				emulator->_v[0xF]=0;
-			}
-
-			emulator->_v[x]-=emulator->_v[y];
-			break;
-		// 8xy6 => SHR Vx {, Vy}
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy6
-		case 0x6:
-			p("SHR V%X\n", x);
-
-			emulator->_v[0xF]=emulator->_v[x]&0x1;
-			emulator->_v[x]>>=1;
-			break;
-		// 8xy7 => SUBN Vx, Vy
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy7
-		case 0x7:
-			p("SUBN  V%X, V%X\n", x, y);
+		NEXT();
+	// 8xy0 => LD Vx, Vy
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy0
+	TARGET(EMULATOR_OP_LD_VY)
+		p("LD  V%X, V%X\n", x, y);
+		emulator->_v[x]=emulator->_v[y];
+		emulator->_pc+=2;
+		NEXT();
+	// 8xy1 => OR Vx, Vy
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy1
+	TARGET(EMULATOR_OP_OR)
+		p("OR  V%X, V%X\n", x, y);
+		emulator->_v[x]|=emulator->_v[y];
+		emulator->_pc+=2;
+		NEXT();
+	// 8xy2 => AND Vx, Vy
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy2
+	TARGET(EMULATOR_OP_AND)
+		p("AND  V%X, V%X\n", x, y);
+		emulator->_v[x]&=emulator->_v[y];
+		emulator->_pc+=2;
+		NEXT();
+	// 8xy3 => XOR Vx, Vy
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy3
+	TARGET(EMULATOR_OP_XOR)
+		p("XOR  V%X, V%X\n", x, y);
+		emulator->_v[x]^=emulator->_v[y];
+		emulator->_pc+=2;
+		NEXT();
+	// 8xy4 => ADD Vx, Vy
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy4
+	TARGET(EMULATOR_OP_ADD_VY)
+		p("ADD  V%X, V%X\n", x, y);
+		const uint8_t sum = emulator->_v[x]+emulator->_v[y];
+
+		// Deu carry
+		if (sum < emulator->_v[x]) {
+			emulator->_v[0xF]=1;
+		} else {
+			emulator->_v[0xF]=0;
+		}
 
-			if (emulator->_v[y] > emulator->_v[x]) {
-				emulator->_v[0xF]=1;
-			} else {
-				emulator->_v[0xF]=0;
-			}
+		emulator->_v[x]+=emulator->_v[y];
+		emulator->_pc+=2;
+		NEXT();
+	// 8xy5 => SUB Vx, Vy
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy5
+	TARGET(EMULATOR_OP_SUB)
+		p("SUB  V%X, V%X\n", x, y);
+
+		// Deu carry
+		if (emulator->_v[x] > emulator->_v[y]) {
+			emulator->_v[0xF]=1;
+		} else {
+			emulator->_v[0xF]=0;
+		}
 
-			emulator->_v[x]=emulator->_v[y]-emulator->_v[x];
-			break;
-		// 8xyE => SHL Vx {, Vy}
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xyE
-		case 0xE:
-			p("SHL V%X\n", x);
-
-		
-			emulator->_v[0xF]=(emulator->_v[x] >> 7) & 0x01;
-			emulator->_v[x]<<=1;
-			break;
-		default:
-			unknown_opcode(opcode);
-			return 1;
+		emulator->_v[x]-=emulator->_v[y];
+		emulator->_pc+=2;
+		NEXT();
+	// 8xy6 => SHR Vx {, Vy}
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy6
+	TARGET(EMULATOR_OP_SHR)
+		p("SHR V%X\n", x);
+
+		emulator->_v[0xF]=emulator->_v[x]&0x1;
+		emulator->_v[x]>>=1;
+		emulator->_pc+=2;
+		NEXT();
+	// 8xy7 => SUBN Vx, Vy
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xy7
+	TARGET(EMULATOR_OP_SUBN)
+		p("SUBN  V%X, V%X\n", x, y);
+
+		if (emulator->_v[y] > emulator->_v[x]) {
+			emulator->_v[0xF]=1;
+		} else {
+			emulator->_v[0xF]=0;
 		}
 
+		emulator->_v[x]=emulator->_v[y]-emulator->_v[x];
 		emulator->_pc+=2;
-		break;
+		NEXT();
+	// 8xyE => SHL Vx {, Vy}
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#8xyE
+	TARGET(EMULATOR_OP_SHL)
+		p("SHL V%X\n", x);
+
+		emulator->_v[0xF]=(emulator->_v[x] >> 7) & 0x01;
+		emulator->_v[x]<<=1;
+		emulator->_pc+=2;
+		NEXT();
 	// 9xy0 => SNE Vx, Vy
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#9xy0
-	case 0x9000:
+	TARGET(EMULATOR_OP_SNE_VY)
 		p("SNE  V%X, V%X\n", x, y);
 
-		// Checa se o opcode está correto e o último valor é zero.
-		if (n != 0) {
-			unknown_opcode(opcode);
-			return 1;
-		}
-
 		if (emulator->_v[x] != emulator->_v[y]) {
 			emulator->_pc+=2;
 		}
 
 		// Tem que pular a instrução pra próxima.
 		emulator->_pc+=2;
-		break;
+		NEXT();
 	// Annn => LD I, addr
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Annn
-	case 0xA000:
+	TARGET(EMULATOR_OP_LD_I)
 		p("LD  I, %03X\n", nnn);
 
 		emulator->_i=nnn;
 
 		emulator->_pc+=2;
-		break;
+		NEXT();
 	// Bnnn => JP V0, addr
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Bnnn
-	case 0xB000:
+	TARGET(EMULATOR_OP_JP_V0)
 		p("JP V0, %03X", nnn);
 
 		emulator->_pc = nnn+emulator->_v[0];
-		break;
+		NEXT();
 	// Cxkk - RND Vx, byte
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Cxkk
-	case 0xC000:
+	TARGET(EMULATOR_OP_RND)
 		p("RND V%X, %02X", x, kk);
 
-		emulator->_v[x]=(rand()%256) & kk;
+		// Os bits altos são os melhores do xoshiro128**
+		emulator->_v[x]=(next_random(emulator) >> 24) & kk;
 
 		emulator->_pc+=2;
-		break;
+		NEXT();
 	// Dxyn => DRW Vx, Vy, nibble
 	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Cxyn
-	case 0xD000:
+	TARGET(EMULATOR_OP_DRW)
 		p("DRW V%X, V%X, %X\n", x, y, n);
 
-		// Parte chata
-		const uint8_t x0 = emulator->_v[x]%EMULATOR_WIDTH;
-		const uint8_t y0 = emulator->_v[y]%EMULATOR_HEIGHT;
-		const uint8_t height = n;
-
-		// Não colidiu
-		emulator->_v[0xF]=0;
-
-		for (uint8_t row=0; row<height; row++) {
-			if (emulator->_i + row >= MEMORY_SIZE) {
-				show_error_message("Error: sprite read out of bounds.\n");
-				return 1;
-			}
-			const uint8_t sprite = emulator->_memory[emulator->_i+row];
-			const uint8_t y = (y0+row) % EMULATOR_HEIGHT;
-
-			for (uint8_t col=0; col<8; col++) {
-				if ((sprite & (0x80 >> col)) == 0) {
-            				continue;
-				}
-				
-				const uint8_t x = (x0 + col) % EMULATOR_WIDTH;
-
-				const uint8_t byte_index = y * (EMULATOR_WIDTH/8) + (x/8);
-				const uint8_t bit_mask = 0x80 >> (x % 8);
-
-				// Detecta colisão
-				if (emulator->screen[byte_index] & bit_mask) {
-					emulator->_v[0xF] = 1;
-				}
-
-				// XOR no pixel
-				emulator->screen[byte_index] ^= bit_mask;
-			}
+		if (!draw_sprite(emulator, emulator->_v[x], emulator->_v[y], n)) {
+			FAULT(EMULATOR_FAULT_SPRITE_OUT_OF_BOUNDS);
 		}
-
 		emulator->draw_flag=true;
 
 		emulator->_pc+=2;
-		break;
-	case 0xE000:
-		switch (kk) {
-		// Ex9E => SKP Vx
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Ex9E
-		case 0x9E:
-			p("SKP V%X\n", x);
-
-			// Não válido
-			if (emulator->_v[x] >= 16) {
-				show_error_message("Invalid key code: 0x%02X. Must be smaller than 0xF (16).\n", emulator->_v[x]);
-				return 1;
-			}
-
-			if (emulator->keys & (1 << emulator->_v[x])) {
-				emulator->_pc+=2;
-			}
+		NEXT();
+	// Ex9E => SKP Vx
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Ex9E
+	TARGET(EMULATOR_OP_SKP)
+		p("SKP V%X\n", x);
+
+		// Não válido
+		if (emulator->_v[x] >= 16) {
+			FAULT(EMULATOR_FAULT_INVALID_KEY);
+		}
 
-			// Tem que pular a instrução pra próxima.
+		if (emulator->keys & (1 << emulator->_v[x])) {
 			emulator->_pc+=2;
-			break;
-		// ExA1 => SKNP Vx
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#ExA1
-		case 0xA1:
-			p("SKNP V%X\n", x);
-
-			// Não válido
-			if (emulator->_v[x] >= 16) {
-				show_error_message("Invalid key code: 0x%02X. Must be smaller than 0xF (16).\n", emulator->_v[x]);
-				return 1;
-			}
+		}
 
-			if (!(emulator->keys & (1 << emulator->_v[x]))) {
-				emulator->_pc+=2;
-			}
+		// Tem que pular a instrução pra próxima.
+		emulator->_pc+=2;
+		NEXT();
+	// ExA1 => SKNP Vx
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#ExA1
+	TARGET(EMULATOR_OP_SKNP)
+		p("SKNP V%X\n", x);
+
+		// Não válido
+		if (emulator->_v[x] >= 16) {
+			FAULT(EMULATOR_FAULT_INVALID_KEY);
+		}
 
-			// Tem que pular a instrução pra próxima.
+		if (!(emulator->keys & (1 << emulator->_v[x]))) {
 			emulator->_pc+=2;
-			break;
-		default:
-			unknown_opcode(opcode);
 		}
-		break;
-	case 0xF000:
-		switch (kk) {
-		// Fx07 - LD Vx, DT
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx07
-		case 0x07:
-			p("LD V%X, DT\n", x);
 
-			emulator->_v[x] = emulator->_delay_timer;
+		// Tem que pular a instrução pra próxima.
+		emulator->_pc+=2;
+		NEXT();
+	// Fx07 - LD Vx, DT
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx07
+	TARGET(EMULATOR_OP_LD_VX_DT)
+		p("LD V%X, DT\n", x);
+
+		emulator->_v[x] = emulator->_delay_timer;
 
+		emulator->_pc+=2;
+		NEXT();
+	// Fx07 no começo de um laço que espera o delay timer. O timer só muda no fim do quadro, então
+	// ou o laço termina agora ou gira até acabar o orçamento; nesse caso pula direto pro estado em
+	// que ele estaria.
+	TARGET(EMULATOR_OP_WAIT_DT_SE)
+	TARGET(EMULATOR_OP_WAIT_DT_SNE)
+		p("LD V%X, DT (wait)\n", x);
+
+		emulator->_v[x] = emulator->_delay_timer;
+
+		// O pulo vai acontecer e o laço termina: segue normalmente
+		if ((d.op == EMULATOR_OP_WAIT_DT_SE) == (emulator->_delay_timer == kk)) {
 			emulator->_pc+=2;
-			break;
-		// Fx0A - LD Vx, K
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx0A
-		case 0x0A:
-			p("LD V%X, K\n", x);
-
-			bool pressed=false;
-			for (uint8_t k=0; k<16; k++) {
-				if (emulator->keys & (1 << k)) {
-					emulator->_v[x]=k;
-					pressed=true;
-					break;
-				}
-			}
+			NEXT();
+		}
 
-			if (pressed) {
-				emulator->_pc+=2;
+		// Cada volta tem 3 instruções, e esta já saiu do orçamento
+		PROFILE_IDLE();
+		TRACE_IDLE();
+		emulator->_pc += 2*((remaining+1) % 3);
+		remaining=0;
+		NEXT();
+	// Fx0A - LD Vx, K
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx0A
+	TARGET(EMULATOR_OP_LD_K)
+		p("LD V%X, K\n", x);
+
+		bool pressed=false;
+		for (uint8_t k=0; k<16; k++) {
+			if (emulator->keys & (1 << k)) {
+				emulator->_v[x]=k;
+				pressed=true;
+				break;
 			}
-			break;
-		// Fx15 => LD DT, Vx
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx15
-		case 0x15:
-			p("LD DT, V%X\n", x);
+		}
 
-			emulator->_delay_timer = emulator->_v[x];
+		if (pressed) {
 			emulator->_pc+=2;
-			break;
-		// Fx18 => LD DT, Vx
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx18
-		case 0x18:
-			p("LD ST, V%X\n", x);
+		}
+		NEXT();
+	// Fx15 => LD DT, Vx
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx15
+	TARGET(EMULATOR_OP_LD_DT)
+		p("LD DT, V%X\n", x);
 
-			emulator->_sound_timer = emulator->_v[x];
-			emulator->_pc+=2;
-			break;
-		// Fx1E => ADD I, Vx
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx1E
-		case 0x1E:
-			p("ADD I, V%X\n", x);
+		emulator->_delay_timer = emulator->_v[x];
+		emulator->_pc+=2;
+		NEXT();
+	// Fx18 => LD DT, Vx
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx18
+	TARGET(EMULATOR_OP_LD_ST)
+		p("LD ST, V%X\n", x);
 
-			// Alguns emuladores colocam a flag em VF. Esse não é um deles.
-			emulator->_i+=emulator->_v[x];
-			emulator->_pc+=2;
-			break;
-		// Fx29 => LD F, Vx
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx29
-		// Coloca a fonte da letra em Vx em I
-		case 0x29:
-			p("LD F, V%X\n", x);
-
-			if (emulator->_v[x] >= 16) {
-				show_error_message("Error: invalid font character: 0x%02x. Must be smaller than 0xF (16).\n", emulator->_v[x]);
-				return 1;
-			}
+		emulator->_sound_timer = emulator->_v[x];
+		emulator->_pc+=2;
+		NEXT();
+	// Fx1E => ADD I, Vx
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx1E
+	TARGET(EMULATOR_OP_ADD_I)
+		p("ADD I, V%X\n", x);
+
+		// Alguns emuladores colocam a flag em VF. Esse não é um deles.
+		emulator->_i+=emulator->_v[x];
+		emulator->_pc+=2;
+		NEXT();
+	// Fx29 => LD F, Vx
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx29
+	// Coloca a fonte da letra em Vx em I
+	TARGET(EMULATOR_OP_LD_F)
+		p("LD F, V%X\n", x);
+
+		if (emulator->_v[x] >= 16) {
+			FAULT(EMULATOR_FAULT_INVALID_FONT);
+		}
 
-			// Cada fonte tem 5 bytes e estão localizadas no início da memória.
-			emulator->_i = emulator->_v[x]*5;
-			emulator->_pc+=2;
-			break;
-		// Fx33 => LD B, Vx
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx33
-		// Armazena o valor de Vx em I como decimal codificado em binário
-		case 0x33:
-			p("LD B, V%X\n", x);
-
-			if (emulator->_i+2 >= MEMORY_SIZE) {
-				show_error_message("Error: instruction LD B, Vx with I=%04X exceeds the memory size.\n", emulator->_i);
-				return 1;
-			}
+		// Cada fonte tem 5 bytes e estão localizadas no início da memória.
+		emulator->_i = emulator->_v[x]*5;
+		emulator->_pc+=2;
+		NEXT();
+	// Fx33 => LD B, Vx
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx33
+	// Armazena o valor de Vx em I como decimal codificado em binário
+	TARGET(EMULATOR_OP_LD_B)
+		p("LD B, V%X\n", x);
+
+		if (emulator->_i+2 >= MEMORY_SIZE) {
+			FAULT(EMULATOR_FAULT_MEMORY_OUT_OF_BOUNDS);
+		}
 
-			emulator->_memory[emulator->_i]=emulator->_v[x]/100; // Centena
-			emulator->_memory[emulator->_i+1]=(emulator->_v[x]/10) % 10; // Dezena
-			emulator->_memory[emulator->_i+2]=emulator->_v[x] % 10; // Unidade
+		emulator->_memory[emulator->_i]=emulator->_v[x]/100; // Centena
+		emulator->_memory[emulator->_i+1]=(emulator->_v[x]/10) % 10; // Dezena
+		emulator->_memory[emulator->_i+2]=emulator->_v[x] % 10; // Unidade
+		invalidate(emulator, emulator->_i, 3);
 
-			emulator->_pc+=2;
-			break;
-		// Fx55 => LD [I], Vx
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx55
-		case 0x55:
-			p("LD [I], V%X\n", x);
+		emulator->_pc+=2;
+		NEXT();
+	// Fx55 => LD [I], Vx
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx55
+	TARGET(EMULATOR_OP_LD_MEM_VX)
+		p("LD [I], V%X\n", x);
+
+		if (emulator->_i + x >= MEMORY_SIZE) {
+			FAULT(EMULATOR_FAULT_MEMORY_OUT_OF_BOUNDS);
+		}
 
-			if (emulator->_i + x >= MEMORY_SIZE) {
-				show_error_message("Error: instruction LD [I], Vx with I=%04X and V%X exceeds the memory size.\n", emulator->_i, x);
-				return 1;
-			}
+		for (uint8_t i=0; i<=x; i++) {
+			emulator->_memory[emulator->_i+i]=emulator->_v[i];
+		}
+		invalidate(emulator, emulator->_i, x+1);
 
-			for (uint8_t i=0; i<=x; i++) {
-				emulator->_memory[emulator->_i+i]=emulator->_v[i];
-			}
+		//emulator->_i+=x+1;
+		emulator->_pc+=2;
+		NEXT();
+	// Fx65 => LD Vx, [I]
+	// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx65
+	TARGET(EMULATOR_OP_LD_VX_MEM)
+		p("LD V%X, [I]\n", x);
+
+		if (emulator->_i + x >= MEMORY_SIZE) {
+			FAULT(EMULATOR_FAULT_MEMORY_OUT_OF_BOUNDS);
+		}
 
-			//emulator->_i+=x+1;
-			emulator->_pc+=2;
-			break;
-		// Fx65 => LD Vx, [I]
-		// http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#Fx65
-		case 0x65:
-			p("LD V%X, [I]\n", x);
+		for (uint8_t i=0; i<=x; i++) {
+			emulator->_v[i]=emulator->_memory[emulator->_i+i];
+		}
 
-			if (emulator->_i + x >= MEMORY_SIZE) {
-				show_error_message("Error: instruction LD Vx, [I] with I=%04X and V%X exceeds the memory size.\n", emulator->_i, x);
-				return 1;
-			}
+		// emulator->_i+=x+1;
+		emulator->_pc+=2;
+		NEXT();
+	// 00Cn => SCD nibble (SUPER-CHIP)
+	// http://devernay.free.fr/hacks/chip8/schip.txt
+	TARGET(EMULATOR_OP_SCD)
+		p("SCD %X\n", n);
 
-			for (uint8_t i=0; i<=x; i++) {
-				emulator->_v[i]=emulator->_memory[emulator->_i+i];
-			}
+		scroll_down(emulator, n);
+		emulator->draw_flag=true;
+		emulator->_pc+=2;
+		NEXT();
+	// 00FB => SCR
+	TARGET(EMULATOR_OP_SCR)
+		p("SCR\n");
 
-			// emulator->_i+=x+1;
-			emulator->_pc+=2;
-			break;
-		default:
-			unknown_opcode(opcode);
-			return 1;
+		scroll_right(emulator);
+		emulator->draw_flag=true;
+		emulator->_pc+=2;
+		NEXT();
+	// 00FC => SCL
+	TARGET(EMULATOR_OP_SCL)
+		p("SCL\n");
+
+		scroll_left(emulator);
+		emulator->draw_flag=true;
+		emulator->_pc+=2;
+		NEXT();
+	// 00FD => EXIT. Não tem pra onde sair: a máquina para aqui, como um 1nnn pro próprio endereço.
+	TARGET(EMULATOR_OP_EXIT)
+		p("EXIT\n");
+
+		PROFILE_IDLE();
+		TRACE_IDLE();
+		remaining=0;
+		NEXT();
+	// 00FE => LOW e 00FF => HIGH. As coordenadas mudam de escala, então a tela é apagada.
+	TARGET(EMULATOR_OP_LOW)
+	TARGET(EMULATOR_OP_HIGH)
+		p("%s\n", d.op == EMULATOR_OP_HIGH ? "HIGH" : "LOW");
+
+		emulator->hires = d.op == EMULATOR_OP_HIGH;
+		memset(emulator->screen, 0, sizeof(emulator->screen));
+		emulator->draw_flag=true;
+		emulator->_pc+=2;
+		NEXT();
+	// Fx30 => LD HF, Vx
+	// Coloca a fonte grande (8x10) do dígito em Vx em I
+	TARGET(EMULATOR_OP_LD_HF)
+		p("LD HF, V%X\n", x);
+
+		if (emulator->_v[x] >= 16) {
+			FAULT(EMULATOR_FAULT_INVALID_FONT);
 		}
-		break;
+
+		emulator->_i = HIRES_FONT_START + emulator->_v[x]*10;
+		emulator->_pc+=2;
+		NEXT();
+	// Fx75 => LD R, Vx
+	TARGET(EMULATOR_OP_LD_RPL_VX)
+		p("LD R, V%X\n", x);
+
+		memcpy(emulator->_rpl, emulator->_v, x+1);
+		emulator->_pc+=2;
+		NEXT();
+	// Fx85 => LD Vx, R
+	TARGET(EMULATOR_OP_LD_VX_RPL)
+		p("LD V%X, R\n", x);
+
+		memcpy(emulator->_v, emulator->_rpl, x+1);
+		emulator->_pc+=2;
+		NEXT();
+#ifndef EMULATOR_THREADED
 	default:
-		unknown_opcode(opcode);
-		return 1;
+#endif
+	TARGET(EMULATOR_OP_UNKNOWN)
+		FAULT(EMULATOR_FAULT_UNKNOWN_OPCODE);
 	}
 
+done:
+	*budget = 0;
 	return 0;
+
+#undef FETCH
+#undef FAULT
+#undef STEP
+#undef STAT_END
+#undef STAT_BEGIN
+#undef PROFILE_STEP
+#undef PROFILE_IDLE
+#undef TRACE_BEGIN
+#undef TRACE_END
+#undef TRACE_IDLE
+#undef TRACE_FAULT
+#undef TARGET
+#undef NEXT
 }
 
-void emulator_tick(struct emulator* emulator) {
-	emulator->draw_flag=false;
+#ifdef EMULATOR_THREADED
+#pragma GCC diagnostic pop
+#endif
 
-	for (size_t i=0; i<emulator->cycles_per_frame; i++) {
-		if (emulator_cycle(emulator) != 0) {
-		// Em testes, a função deve ser avançada não importa qual seja
-#ifndef TEST
-			exit(EXIT_FAILURE);
-#else
-			emulator->_pc+=2;
+// Roda o orçamento do quadro, usando os blocos do JIT quando existirem.
+static int run(struct emulator* emulator, size_t* budget) {
+#ifdef EMULATOR_JIT
+#ifdef EMULATOR_PROFILE
+	// Os blocos do JIT não passam pelo profiler
+	if (emulator->_profile != NULL) {
+		return execute(emulator, budget);
+	}
+#endif
+#ifdef EMULATOR_TRACE
+	// Nem pelo trace
+	if (emulator->_trace != NULL) {
+		return execute(emulator, budget);
+	}
 #endif
+	while (*budget > 0 && emulator->_jit != NULL) {
+		switch (jit_run(emulator->_jit, emulator, budget)) {
+		case JIT_RAN:
+			break;
+		case JIT_MISS: {
+			// Laço ocioso nunca vira bloco: o interpretador adianta o resto do quadro de uma vez
+			if (emulator_idle_loop(emulator, emulator->_pc)) {
+				return execute(emulator, budget);
+			}
+			// Uma instrução no interpretador e tenta de novo
+			size_t one = 1;
+			const int result = execute(emulator, &one);
+			(*budget)--;
+			if (result != 0) {
+				return 1;
+			}
+			break;
+		}
+		case JIT_SHORT:
+			return execute(emulator, budget);
 		}
 	}
+#endif
+	return execute(emulator, budget);
+}
+
+int emulator_cycle(struct emulator* emulator) {
+	size_t budget = 1;
+	return execute(emulator, &budget);
+}
+
+int emulator_run(struct emulator* emulator, size_t cycles) {
+	return run(emulator, &cycles);
+}
 
+void emulator_end_frame(struct emulator* emulator) {
 	if (emulator->_sound_timer == 1) {
 		emulator->beep_flag=true;	
 	} else {
@@ -645,4 +1391,272 @@ void emulator_tick(struct emulator* emulator) {
 	if (emulator->_sound_timer > 0) {
 		emulator->_sound_timer--;
 	}
-}
\ No newline at end of file
+
+#ifdef EMULATOR_TRACE
+	if (emulator->_trace != NULL) {
+		trace_frame(emulator->_trace, emulator);
+	}
+#endif
+}
+
+int emulator_tick(struct emulator* emulator) {
+	emulator->draw_flag=false;
+
+	size_t budget = emulator->cycles_per_frame;
+	if (run(emulator, &budget) != 0) {
+		return 1;
+	}
+
+	emulator_end_frame(emulator);
+	return 0;
+}
+
+// Copia memory pra memória do emulador em pedaços, invalidando os caches só nos pedaços que mudaram
+#define COPY_CHUNK 64
+static void copy_memory(struct emulator* emulator, const uint8_t* memory) {
+	for (uint16_t addr=0; addr<MEMORY_SIZE; addr+=COPY_CHUNK) {
+		if (memcmp(emulator->_memory + addr, memory + addr, COPY_CHUNK) != 0) {
+			memcpy(emulator->_memory + addr, memory + addr, COPY_CHUNK);
+			invalidate(emulator, addr, COPY_CHUNK);
+		}
+	}
+}
+
+int emulator_reset(struct emulator* emulator, const uint8_t* rom, size_t size, uint64_t seed) {
+	if (size > MEMORY_SIZE-MEMORY_START) {
+		return EMULATOR_ERROR_TOO_BIG;
+	}
+
+	uint8_t memory[MEMORY_SIZE] = { 0 };
+	load_fonts(memory);
+	if (size > 0) {
+		memcpy(memory + MEMORY_START, rom, size);
+	}
+	copy_memory(emulator, memory);
+
+	reset_registers(emulator);
+	emulator_seed(emulator, seed);
+
+	return EMULATOR_OK;
+}
+
+void emulator_snapshot(const struct emulator* emulator, struct emulator_snapshot* snapshot) {
+	// Zera o padding também: estados iguais dão bytes iguais, e nada do que estava no buffer vaza
+	memset(snapshot, 0, sizeof(struct emulator_snapshot));
+	snapshot->version = EMULATOR_SNAPSHOT_VERSION;
+	snapshot->size = sizeof(struct emulator_snapshot);
+
+	memcpy(snapshot->screen, emulator->screen, sizeof(snapshot->screen));
+	memcpy(snapshot->memory, emulator->_memory, sizeof(snapshot->memory));
+	memcpy(snapshot->stack, emulator->_stack, sizeof(snapshot->stack));
+	snapshot->sp = emulator->_sp;
+	snapshot->i = emulator->_i;
+	snapshot->pc = emulator->_pc;
+	snapshot->keys = emulator->keys;
+	memcpy(snapshot->rng, emulator->_rng, sizeof(snapshot->rng));
+	memcpy(snapshot->v, emulator->_v, sizeof(snapshot->v));
+	memcpy(snapshot->rpl, emulator->_rpl, sizeof(snapshot->rpl));
+	snapshot->delay_timer = emulator->_delay_timer;
+	snapshot->sound_timer = emulator->_sound_timer;
+	snapshot->cycles_per_frame = emulator->cycles_per_frame;
+	snapshot->hires = emulator->hires;
+	snapshot->draw_flag = emulator->draw_flag;
+	snapshot->beep_flag = emulator->beep_flag;
+}
+
+int emulator_restore(struct emulator* emulator, const struct emulator_snapshot* snapshot) {
+	if (snapshot->version != EMULATOR_SNAPSHOT_VERSION || snapshot->size != sizeof(struct emulator_snapshot)) {
+		return 1;
+	}
+
+	copy_memory(emulator, snapshot->memory);
+
+	memcpy(emulator->screen, snapshot->screen, sizeof(emulator->screen));
+	memcpy(emulator->_stack, snapshot->stack, sizeof(emulator->_stack));
+	emulator->_sp = snapshot->sp;
+	emulator->_i = snapshot->i;
+	emulator->_pc = snapshot->pc;
+	emulator->keys = snapshot->keys;
+	memset(&emulator->fault, 0, sizeof(emulator->fault));
+	memcpy(emulator->_rng, snapshot->rng, sizeof(emulator->_rng));
+	memcpy(emulator->_v, snapshot->v, sizeof(emulator->_v));
+	memcpy(emulator->_rpl, snapshot->rpl, sizeof(emulator->_rpl));
+	emulator->_delay_timer = snapshot->delay_timer;
+	emulator->_sound_timer = snapshot->sound_timer;
+	emulator->cycles_per_frame = snapshot->cycles_per_frame;
+	emulator->hires = snapshot->hires;
+	emulator->draw_flag = snapshot->draw_flag;
+	emulator->beep_flag = snapshot->beep_flag;
+
+	return 0;
+}
+
+void emulator_clone(struct emulator* dst, const struct emulator* src) {
+	copy_memory(dst, src->_memory);
+
+	memcpy(dst->screen, src->screen, sizeof(dst->screen));
+	memcpy(dst->_stack, src->_stack, sizeof(dst->_stack));
+	dst->_sp = src->_sp;
+	dst->_i = src->_i;
+	dst->_pc = src->_pc;
+	dst->keys = src->keys;
+	dst->fault = src->fault;
+	memcpy(dst->_rng, src->_rng, sizeof(dst->_rng));
+	memcpy(dst->_v, src->_v, sizeof(dst->_v));
+	memcpy(dst->_rpl, src->_rpl, sizeof(dst->_rpl));
+	dst->_delay_timer = src->_delay_timer;
+	dst->_sound_timer = src->_sound_timer;
+	dst->cycles_per_frame = src->cycles_per_frame;
+	dst->hires = src->hires;
+	dst->draw_flag = src->draw_flag;
+	dst->beep_flag = src->beep_flag;
+}
+
+#define FNV_OFFSET 0xCBF29CE484222325
+#define FNV_PRIME  0x100000001B3
+
+static inline uint64_t hash_bytes(uint64_t hash, const uint8_t* bytes, size_t len) {
+	for (size_t j=0; j<len; j++) {
+		hash = (hash ^ bytes[j]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+// Byte mais alto primeiro, independente do endianness
+static inline uint64_t hash_word(uint64_t hash, uint64_t word, uint8_t bytes) {
+	while (bytes-- > 0) {
+		hash = (hash ^ ((word >> (8*bytes)) & 0xFF)) * FNV_PRIME;
+	}
+	return hash;
+}
+
+// Na baixa resolução são só as palavras de antes do SUPER-CHIP, então o hash da tela não mudou
+uint64_t emulator_screen_hash(const struct emulator* emulator) {
+	uint64_t hash = FNV_OFFSET;
+	if (!emulator->hires) {
+		for (uint8_t y=0; y<EMULATOR_HEIGHT; y++) {
+			hash = hash_word(hash, emulator->screen[y][0], 8);
+		}
+		return hash;
+	}
+
+	for (uint8_t y=0; y<EMULATOR_HIRES_HEIGHT; y++) {
+		hash = hash_word(hash, emulator->screen[y][0], 8);
+		hash = hash_word(hash, emulator->screen[y][1], 8);
+	}
+	return hash;
+}
+
+uint64_t emulator_state_hash(const struct emulator* emulator) {
+	uint64_t hash = emulator_screen_hash(emulator);
+
+	hash = hash_bytes(hash, emulator->_memory, MEMORY_SIZE);
+	hash = hash_bytes(hash, emulator->_v, sizeof(emulator->_v));
+	hash = hash_bytes(hash, emulator->_rpl, sizeof(emulator->_rpl));
+	hash = hash_word(hash, emulator->hires, 1);
+	hash = hash_word(hash, emulator->_i, 2);
+	hash = hash_word(hash, emulator->_pc, 2);
+	hash = hash_word(hash, emulator->_sp, 2);
+	for (uint16_t j=0; j<emulator->_sp && j<STACK_SIZE; j++) {
+		hash = hash_word(hash, emulator->_stack[j], 2);
+	}
+	hash = hash_word(hash, emulator->_delay_timer, 1);
+	hash = hash_word(hash, emulator->_sound_timer, 1);
+	for (uint8_t j=0; j<4; j++) {
+		hash = hash_word(hash, emulator->_rng[j], 4);
+	}
+
+	return hash;
+}
+
+#ifdef EMULATOR_STATS
+static const char* const op_names[EMULATOR_OP_COUNT] = {
+	[EMULATOR_OP_UNDECODED]   = "-",
+	[EMULATOR_OP_CLS]         = "00E0 CLS",
+	[EMULATOR_OP_RET]         = "00EE RET",
+	[EMULATOR_OP_SYS]         = "0nnn SYS",
+	[EMULATOR_OP_JP]          = "1nnn JP",
+	[EMULATOR_OP_CALL]        = "2nnn CALL",
+	[EMULATOR_OP_SE_KK]       = "3xkk SE",
+	[EMULATOR_OP_SNE_KK]      = "4xkk SNE",
+	[EMULATOR_OP_SE_VY]       = "5xy0 SE",
+	[EMULATOR_OP_LD_KK]       = "6xkk LD",
+	[EMULATOR_OP_ADD_KK]      = "7xkk ADD",
+	[EMULATOR_OP_LD_VY]       = "8xy0 LD",
+	[EMULATOR_OP_OR]          = "8xy1 OR",
+	[EMULATOR_OP_AND]         = "8xy2 AND",
+	[EMULATOR_OP_XOR]         = "8xy3 XOR",
+	[EMULATOR_OP_ADD_VY]      = "8xy4 ADD",
+	[EMULATOR_OP_SUB]         = "8xy5 SUB",
+	[EMULATOR_OP_SHR]         = "8xy6 SHR",
+	[EMULATOR_OP_SUBN]        = "8xy7 SUBN",
+	[EMULATOR_OP_SHL]         = "8xyE SHL",
+	[EMULATOR_OP_SNE_VY]      = "9xy0 SNE",
+	[EMULATOR_OP_LD_I]        = "Annn LD I",
+	[EMULATOR_OP_JP_V0]       = "Bnnn JP V0",
+	[EMULATOR_OP_RND]         = "Cxkk RND",
+	[EMULATOR_OP_DRW]         = "Dxyn DRW",
+	[EMULATOR_OP_SKP]         = "Ex9E SKP",
+	[EMULATOR_OP_SKNP]        = "ExA1 SKNP",
+	[EMULATOR_OP_LD_VX_DT]    = "Fx07 LD DT",
+	[EMULATOR_OP_LD_K]        = "Fx0A LD K",
+	[EMULATOR_OP_LD_DT]       = "Fx15 LD DT",
+	[EMULATOR_OP_LD_ST]       = "Fx18 LD ST",
+	[EMULATOR_OP_ADD_I]       = "Fx1E ADD I",
+	[EMULATOR_OP_LD_F]        = "Fx29 LD F",
+	[EMULATOR_OP_LD_B]        = "Fx33 LD B",
+	[EMULATOR_OP_LD_MEM_VX]   = "Fx55 LD [I]",
+	[EMULATOR_OP_LD_VX_MEM]   = "Fx65 LD Vx",
+	[EMULATOR_OP_SCD]         = "00Cn SCD",
+	[EMULATOR_OP_SCR]         = "00FB SCR",
+	[EMULATOR_OP_SCL]         = "00FC SCL",
+	[EMULATOR_OP_EXIT]        = "00FD EXIT",
+	[EMULATOR_OP_LOW]         = "00FE LOW",
+	[EMULATOR_OP_HIGH]        = "00FF HIGH",
+	[EMULATOR_OP_LD_HF]       = "Fx30 LD HF",
+	[EMULATOR_OP_LD_RPL_VX]   = "Fx75 LD R",
+	[EMULATOR_OP_LD_VX_RPL]   = "Fx85 LD Vx, R",
+	[EMULATOR_OP_UNKNOWN]     = "unknown",
+	[EMULATOR_OP_JP_SELF]     = "idle JP self",
+	[EMULATOR_OP_WAIT_DT_SE]  = "idle wait DT (SE)",
+	[EMULATOR_OP_WAIT_DT_SNE] = "idle wait DT (SNE)",
+};
+
+void emulator_print_stats(const struct emulator* emulator, FILE* out) {
+	uint64_t total_count = 0;
+	uint64_t total_ticks = 0;
+	bool printed[EMULATOR_OP_COUNT] = { false };
+
+	for (uint8_t op=0; op<EMULATOR_OP_COUNT; op++) {
+		total_count += emulator->_op_count[op];
+		total_ticks += emulator->_op_ticks[op];
+	}
+
+	fprintf(out, "%-20s %14s %7s %16s %7s %10s\n", "instruction", "count", "count%", "ticks", "ticks%", "ticks/op");
+
+	// Seleção simples: são só algumas dezenas de linhas
+	for (;;) {
+		int best = -1;
+		for (uint8_t op=0; op<EMULATOR_OP_COUNT; op++) {
+			if (!printed[op] && emulator->_op_count[op] > 0 &&
+				(best < 0 || emulator->_op_ticks[op] > emulator->_op_ticks[best])) {
+				best = op;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+		printed[best] = true;
+
+		const uint64_t count = emulator->_op_count[best];
+		const uint64_t ticks = emulator->_op_ticks[best];
+		fprintf(out, "%-20s %14llu %6.2f%% %16llu %6.2f%% %10.1f\n", op_names[best],
+			(unsigned long long)count, 100.0 * count / total_count,
+			(unsigned long long)ticks, total_ticks > 0 ? 100.0 * ticks / total_ticks : 0.0,
+			(double)ticks / count);
+	}
+
+	fprintf(out, "%-20s %14llu %7s %16llu\n", "total", (unsigned long long)total_count, "",
+		(unsigned long long)total_ticks);
+}
+#endif
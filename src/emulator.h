@@ -18,22 +18,132 @@
 #ifndef EMULATOR_H
 #define EMULATOR_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#ifdef EMULATOR_STATS
+#include <stdio.h>
+#endif
 
 #define EMULATOR_WIDTH 64
 #define EMULATOR_HEIGHT 32
 
+// Alta resolução do SUPER-CHIP (00FF)
+#define EMULATOR_HIRES_WIDTH 128
+#define EMULATOR_HIRES_HEIGHT 64
+
 #define MEMORY_START 0x200
 
 #define MEMORY_SIZE 0x1000
 #define STACK_SIZE 12
 
+// Classes de instrução. Cada uma vira um handler no emulator_cycle.
+enum emulator_op {
+	EMULATOR_OP_UNDECODED=0, // Entrada do cache ainda não preenchida
+	EMULATOR_OP_CLS,    // 00E0
+	EMULATOR_OP_RET,    // 00EE
+	EMULATOR_OP_SYS,    // 0nnn
+	EMULATOR_OP_JP,     // 1nnn
+	EMULATOR_OP_CALL,   // 2nnn
+	EMULATOR_OP_SE_KK,  // 3xkk
+	EMULATOR_OP_SNE_KK, // 4xkk
+	EMULATOR_OP_SE_VY,  // 5xy0
+	EMULATOR_OP_LD_KK,  // 6xkk
+	EMULATOR_OP_ADD_KK, // 7xkk
+	EMULATOR_OP_LD_VY,  // 8xy0
+	EMULATOR_OP_OR,     // 8xy1
+	EMULATOR_OP_AND,    // 8xy2
+	EMULATOR_OP_XOR,    // 8xy3
+	EMULATOR_OP_ADD_VY, // 8xy4
+	EMULATOR_OP_SUB,    // 8xy5
+	EMULATOR_OP_SHR,    // 8xy6
+	EMULATOR_OP_SUBN,   // 8xy7
+	EMULATOR_OP_SHL,    // 8xyE
+	EMULATOR_OP_SNE_VY, // 9xy0
+	EMULATOR_OP_LD_I,   // Annn
+	EMULATOR_OP_JP_V0,  // Bnnn
+	EMULATOR_OP_RND,    // Cxkk
+	EMULATOR_OP_DRW,    // Dxyn
+	EMULATOR_OP_SKP,    // Ex9E
+	EMULATOR_OP_SKNP,   // ExA1
+	EMULATOR_OP_LD_VX_DT, // Fx07
+	EMULATOR_OP_LD_K,   // Fx0A
+	EMULATOR_OP_LD_DT,  // Fx15
+	EMULATOR_OP_LD_ST,  // Fx18
+	EMULATOR_OP_ADD_I,  // Fx1E
+	EMULATOR_OP_LD_F,   // Fx29
+	EMULATOR_OP_LD_B,   // Fx33
+	EMULATOR_OP_LD_MEM_VX, // Fx55
+	EMULATOR_OP_LD_VX_MEM, // Fx65
+
+	// SUPER-CHIP 1.1
+	EMULATOR_OP_SCD,    // 00Cn
+	EMULATOR_OP_SCR,    // 00FB
+	EMULATOR_OP_SCL,    // 00FC
+	EMULATOR_OP_EXIT,   // 00FD
+	EMULATOR_OP_LOW,    // 00FE
+	EMULATOR_OP_HIGH,   // 00FF
+	EMULATOR_OP_LD_HF,  // Fx30
+	EMULATOR_OP_LD_RPL_VX, // Fx75
+	EMULATOR_OP_LD_VX_RPL, // Fx85
+
+	EMULATOR_OP_UNKNOWN,
+
+	// Laços ociosos, reconhecidos na decodificação
+	EMULATOR_OP_JP_SELF,     // 1nnn com nnn igual ao próprio endereço
+	EMULATOR_OP_WAIT_DT_SE,  // Fx07; 3xkk; 1nnn de volta pro Fx07
+	EMULATOR_OP_WAIT_DT_SNE, // Fx07; 4xkk; 1nnn de volta pro Fx07
+
+	EMULATOR_OP_COUNT
+};
+
+// Por que uma instrução falhou. O emulator_cycle, o emulator_run e o emulator_tick retornam 1 e
+// guardam o tipo, o endereço e o opcode em emulator->fault; o núcleo não imprime nada.
+enum emulator_fault_kind {
+	EMULATOR_FAULT_NONE=0,
+	EMULATOR_FAULT_PC_OUT_OF_BOUNDS, // PC depois do fim da memória
+	EMULATOR_FAULT_STACK_UNDERFLOW,  // RET com a stack vazia
+	EMULATOR_FAULT_STACK_OVERFLOW,   // CALL com a stack cheia
+	EMULATOR_FAULT_UNKNOWN_OPCODE,
+	EMULATOR_FAULT_SPRITE_OUT_OF_BOUNDS, // Dxyn lendo depois do fim da memória
+	EMULATOR_FAULT_INVALID_KEY,      // Ex9E/ExA1 com Vx maior que 0xF
+	EMULATOR_FAULT_INVALID_FONT,     // Fx29/Fx30 com Vx maior que 0xF
+	EMULATOR_FAULT_MEMORY_OUT_OF_BOUNDS, // Fx33/Fx55/Fx65 passando do fim da memória
+
+	EMULATOR_FAULT_COUNT
+};
+
+struct emulator_fault {
+	uint8_t kind; // EMULATOR_FAULT_*
+	uint16_t pc;
+	uint16_t opcode; // 0 se o PC estiver fora da memória
+};
+
+const char* emulator_fault_string(int kind);
+
+struct jit;
+struct profile;
+struct trace;
+
+// Instrução já decodificada: o handler e os operandos extraídos do opcode.
+struct emulator_decoded {
+	uint8_t op;
+	uint8_t x;
+	uint8_t y;
+	uint8_t kk; // n são os 4 bits menores
+	uint16_t nnn;
+};
+
 struct emulator {
 	uint8_t cycles_per_frame;
 
-	// Cada bit um pixel
-	uint8_t screen[EMULATOR_WIDTH/8 * EMULATOR_HEIGHT];
+	// Uma linha de 128 bits por par de palavras, cada bit um pixel. O bit mais alto de screen[y][0]
+	// é a coluna 0 e o de screen[y][1] é a coluna 64. Na baixa resolução só as 32 primeiras
+	// linhas de screen[y][0] são usadas, e o resto fica zerado.
+	uint64_t screen[EMULATOR_HIRES_HEIGHT][2];
+
+	// 128x64 (SUPER-CHIP) em vez de 64x32
+	bool hires;
 
 	bool draw_flag;
 	bool beep_flag;
@@ -41,6 +151,9 @@ struct emulator {
 	// Cada bit uma tecla
 	uint16_t keys;
 
+	// A última falha; kind é EMULATOR_FAULT_NONE até a primeira
+	struct emulator_fault fault;
+
 	uint8_t _memory[MEMORY_SIZE];
 
 	uint16_t _stack[STACK_SIZE];
@@ -53,13 +166,162 @@ struct emulator {
 
 	uint8_t _delay_timer;
 	uint8_t _sound_timer;
+
+	// Flags RPL da HP48 (Fx75/Fx85). O SUPER-CHIP só tem 8; aqui cabem os 16 registradores.
+	uint8_t _rpl[16];
+
+	// Estado do gerador do Cxkk (xoshiro128**). Fica aqui, e não no rand() global, pra que cada
+	// instância seja reproduzível e independente das outras.
+	uint32_t _rng[4];
+
+	// Cache de instruções decodificadas, uma entrada por endereço par. Preenchido na primeira
+	// execução de cada endereço e invalidado quando a memória é escrita (Fx33/Fx55).
+	struct emulator_decoded _decoded[MEMORY_SIZE/2];
+
+	// Blocos recompilados (só com ENGINE=jit). NULL roda tudo no interpretador.
+	struct jit* _jit;
+
+#ifdef EMULATOR_PROFILE
+	// Profiler do programa emulado (só com PROFILE=1). NULL desliga.
+	struct profile* _profile;
+#endif
+
+#ifdef EMULATOR_TRACE
+	// Trace binário da execução (só com TRACE=1). NULL desliga.
+	struct trace* _trace;
+#endif
+
+#ifdef EMULATOR_STATS
+	// Quantas vezes cada classe rodou no interpretador e quantos ticks do contador do processador
+	// (rdtsc) levou, incluindo a busca e o despacho
+	uint64_t _op_count[EMULATOR_OP_COUNT];
+	uint64_t _op_ticks[EMULATOR_OP_COUNT];
+#endif
+};
+
+// Muda sempre que o layout da struct emulator_snapshot mudar
+#define EMULATOR_SNAPSHOT_VERSION 2
+
+// Estado completo da máquina, sem os caches (decodificação e JIT), que são reconstruídos sozinhos.
+// Pode ser copiado com memcpy e gravado em arquivo, desde que lido na mesma arquitetura.
+struct emulator_snapshot {
+	uint32_t version;
+	uint32_t size; // sizeof(struct emulator_snapshot)
+
+	uint64_t screen[EMULATOR_HIRES_HEIGHT][2];
+	uint8_t memory[MEMORY_SIZE];
+	uint16_t stack[STACK_SIZE];
+	uint16_t sp;
+	uint16_t i;
+	uint16_t pc;
+	uint16_t keys;
+	uint32_t rng[4];
+	uint8_t v[16];
+	uint8_t rpl[16];
+	uint8_t delay_timer;
+	uint8_t sound_timer;
+	uint8_t cycles_per_frame;
+	bool hires;
+	bool draw_flag;
+	bool beep_flag;
+};
+
+// O que as funções que carregam ROMs retornam. Nenhuma delas sai do programa.
+enum emulator_error {
+	EMULATOR_OK = 0,
+	EMULATOR_ERROR_OPEN,    // O errno diz por quê
+	EMULATOR_ERROR_READ,    // Também quando não é um arquivo comum
+	EMULATOR_ERROR_TOO_BIG, // Não cabe entre MEMORY_START e o fim da memória
 };
 
-void emulator_init(struct emulator* emulator, const char* rom);
+const char* emulator_error_string(int error);
+
+// Uma ROM mapeada só pra leitura. As páginas do arquivo são compartilhadas, então um processo pode
+// mapear um corpus inteiro uma vez e iniciar quantas instâncias quiser a partir dele.
+struct emulator_rom {
+	const uint8_t* data;
+	size_t size;
+
+	void* _mapping;
+};
+
+int emulator_rom_map(struct emulator_rom* rom, const char* path);
+void emulator_rom_unmap(struct emulator_rom* rom);
+
+// A mesma ROM com a mesma semente (e as mesmas teclas) sempre roda igual. Em caso de erro, emulator
+// fica como estava e não precisa de emulator_quit.
+int emulator_init(struct emulator* emulator, const char* path, uint64_t seed);
+
+// O mesmo, com a ROM já na memória. Só copia rom, sem nenhuma chamada ao sistema além do JIT.
+int emulator_init_from_buffer(struct emulator* emulator, const uint8_t* rom, size_t size, uint64_t seed);
+
+// Volta pro estado do emulator_init com outra ROM, sem abrir arquivo. Só o que mudou na memória é
+// invalidado nos caches, então reiniciar com a mesma ROM custa pouco. emulator tem que ter passado
+// pelo emulator_init (ou estar zerado). Retorna EMULATOR_ERROR_TOO_BIG se a ROM não couber.
+int emulator_reset(struct emulator* emulator, const uint8_t* rom, size_t size, uint64_t seed);
 
-void emulator_tick(struct emulator* emulator);
+// Reinicia o gerador de números aleatórios.
+void emulator_seed(struct emulator* emulator, uint64_t seed);
+
+// Libera o que o emulator_init alocou.
+void emulator_quit(struct emulator* emulator);
+
+void emulator_snapshot(const struct emulator* emulator, struct emulator_snapshot* snapshot);
+
+// Volta pro estado do snapshot. Só o que mudou na memória é invalidado nos caches, então voltar
+// pra um estado próximo custa pouco mais que a cópia. Retorna 1 se o snapshot for de outra versão.
+int emulator_restore(struct emulator* emulator, const struct emulator_snapshot* snapshot);
+
+// Faz de dst uma cópia de src sem passar por um snapshot. dst tem que ter passado pelo
+// emulator_init (ou estar zerado) e continua com o próprio JIT.
+void emulator_clone(struct emulator* dst, const struct emulator* src);
+
+// O tamanho da tela na resolução atual
+static inline uint8_t emulator_width(const struct emulator* emulator) {
+	return emulator->hires ? EMULATOR_HIRES_WIDTH : EMULATOR_WIDTH;
+}
+
+static inline uint8_t emulator_height(const struct emulator* emulator) {
+	return emulator->hires ? EMULATOR_HIRES_HEIGHT : EMULATOR_HEIGHT;
+}
+
+// x e y na resolução atual
+static inline bool emulator_pixel(const struct emulator* emulator, uint8_t x, uint8_t y) {
+	return (emulator->screen[y][x >> 6] >> (63 - (x & 63))) & 1;
+}
+
+// Quantos ticks o som ainda toca, contando o quadro atual (antes do emulator_end_frame).
+static inline uint8_t emulator_sound_timer(const struct emulator* emulator) {
+	return emulator->_sound_timer;
+}
+
+// FNV-1a da tela (só a parte da resolução atual), e do estado todo (tela, memória, registradores,
+// pilha, timers, gerador e o estado do SUPER-CHIP). Os valores são os mesmos em qualquer
+// plataforma, pra comparar execuções em máquinas diferentes.
+uint64_t emulator_screen_hash(const struct emulator* emulator);
+uint64_t emulator_state_hash(const struct emulator* emulator);
+
+// Diz se pc começa um laço que só espera o delay timer (ou salta pra si mesmo, ou para no 00FD).
+// O emulator_tick adianta esses laços direto pro fim do quadro em vez de rodar cada volta.
+bool emulator_idle_loop(const struct emulator* emulator, uint16_t pc);
+
+// Um quadro: cycles_per_frame instruções e os timers. Retorna 1 se uma instrução falhar, com o PC
+// parado nela e sem os timers do quadro.
+int emulator_tick(struct emulator* emulator);
+
+#ifdef EMULATOR_STATS
+// Imprime a tabela de contagem e tempo por classe de instrução, da mais cara pra mais barata.
+void emulator_print_stats(const struct emulator* emulator, FILE* out);
+#endif
 
 int emulator_cycle(struct emulator* emulator);
 
+// Roda até cycles instruções com o núcleo compilado (blocos do JIT e laços ociosos adiantados),
+// sem os timers. Retorna 1 se uma instrução falhar, com o PC parado nela.
+int emulator_run(struct emulator* emulator, size_t cycles);
+
+// O que o emulator_tick faz no fim do quadro: beep_flag e timers.
+void emulator_end_frame(struct emulator* emulator);
+
 
 #endif
\ No newline at end of file
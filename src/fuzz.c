@@ -0,0 +1,140 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+// Alvo de fuzzing do núcleo. A entrada é um cabeçalho com o tamanho da execução e as teclas,
+// seguido da ROM:
+//
+//   byte 0      quadros (1 + byte % MAX_FRAMES)
+//   byte 1      instruções por quadro (0 vira 1)
+//   bytes 2-17  8 máscaras de teclas de 16 bits (little-endian), uma por quadro, em rodízio
+//   resto       a ROM, carregada em 0x200 (cortada se não couber)
+//
+// Sem FUZZ_MAIN é o LLVMFuzzerTestOneInput do libFuzzer. Com FUZZ_MAIN ganha um main que roda os
+// arquivos passados (ou o stdin), pra reproduzir uma falha com qualquer compilador, e que com o
+// afl-clang-fast vira o laço persistente do AFL++.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emulator.h"
+
+#define HEADER_SIZE 18
+#define KEY_MASKS 8
+
+// Limita o trabalho por entrada: no máximo 64*255 instruções
+#define MAX_FRAMES 64
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+// Reaproveitado entre as entradas: o emulator_reset só invalida os caches onde a ROM mudou
+static struct emulator emulator;
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	if (size < HEADER_SIZE) {
+		return 0;
+	}
+
+	const unsigned frames = 1 + data[0] % MAX_FRAMES;
+	const uint8_t cycles_per_frame = data[1] == 0 ? 1 : data[1];
+
+	uint16_t keys[KEY_MASKS];
+	for (int k=0; k<KEY_MASKS; k++) {
+		keys[k] = data[2 + 2*k] | data[3 + 2*k] << 8;
+	}
+
+	size_t rom_size = size - HEADER_SIZE;
+	if (rom_size > MEMORY_SIZE-MEMORY_START) {
+		rom_size = MEMORY_SIZE-MEMORY_START;
+	}
+
+	emulator_reset(&emulator, data + HEADER_SIZE, rom_size, 0);
+	emulator.cycles_per_frame = cycles_per_frame;
+
+	for (unsigned frame=0; frame<frames; frame++) {
+		emulator.keys = keys[frame % KEY_MASKS];
+		emulator.draw_flag = false;
+
+		for (uint8_t c=0; c<cycles_per_frame; c++) {
+			// A falha é uma saída válida; o que interessa são os sanitizers
+			if (emulator_cycle(&emulator) != 0) {
+				return 0;
+			}
+		}
+
+		emulator_end_frame(&emulator);
+	}
+
+	return 0;
+}
+
+#ifdef FUZZ_MAIN
+
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+__AFL_FUZZ_INIT();
+
+int main(void) {
+	__AFL_INIT();
+	const uint8_t* data = __AFL_FUZZ_TESTCASE_BUF;
+
+	while (__AFL_LOOP(100000)) {
+		LLVMFuzzerTestOneInput(data, __AFL_FUZZ_TESTCASE_LEN);
+	}
+
+	return EXIT_SUCCESS;
+}
+#else
+static int run_file(FILE* file, const char* name) {
+	// Cabeçalho e a maior ROM possível
+	static uint8_t data[HEADER_SIZE + MEMORY_SIZE];
+
+	const size_t size = fread(data, 1, sizeof(data), file);
+	if (ferror(file)) {
+		fprintf(stderr, "Error: failed to read %s.\n", name);
+		return 1;
+	}
+
+	LLVMFuzzerTestOneInput(data, size);
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		return run_file(stdin, "stdin") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+	for (int arg=1; arg<argc; arg++) {
+		FILE* file = fopen(argv[arg], "rb");
+		if (file == NULL) {
+			perror(argv[arg]);
+			result = EXIT_FAILURE;
+			continue;
+		}
+
+		if (run_file(file, argv[arg]) != 0) {
+			result = EXIT_FAILURE;
+		}
+		fclose(file);
+	}
+
+	return result;
+}
+#endif
+
+#endif
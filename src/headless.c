@@ -0,0 +1,343 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+// Roda uma ROM sem janela, som ou espera entre quadros, e imprime o tempo e o hash do estado final.
+// Serve pra testes de regressão e medidas de velocidade em máquinas sem tela.
+
+// clock_gettime
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "emulator.h"
+#include "input_script.h"
+#include "movie.h"
+#ifdef EMULATOR_PROFILE
+#include "profile.h"
+#endif
+#ifdef EMULATOR_TRACE
+#include "trace.h"
+#endif
+
+#define DEFAULT_FRAMES 600
+
+struct emulator emulator;
+
+static inline void show_usage(const char* argv0) {
+	printf("%s <rom_file> [options]\n", argv0);
+	printf("  --frames N            run N frames (default %d)\n", DEFAULT_FRAMES);
+	printf("  --cycles N            run N instructions instead\n");
+	printf("  --cycles-per-frame N  instructions per frame, 1-255 (default 16)\n");
+	printf("  --seed N              seed for the random number generator (default 0)\n");
+	printf("  --input FILE          scripted input: one \"<frame> <keys>\" per line, where keys are\n");
+	printf("                        the CHIP-8 keys held from that frame on (0-F) or - for none\n");
+	printf("  --record FILE         record the seed and the keys of every frame to a movie\n");
+	printf("  --replay FILE         replay a movie (its seed, speed and keys) to the end and check\n");
+	printf("                        that it reaches the recorded state\n");
+#ifdef EMULATOR_PROFILE
+	printf("  --profile FILE        write the guest call stacks in folded format (for flamegraph.pl)\n");
+	printf("                        and print the hottest addresses and subroutines\n");
+#endif
+#ifdef EMULATOR_TRACE
+	printf("  --trace FILE          write a binary trace of every instruction and what it changed\n");
+#endif
+}
+
+static uint64_t parse_number(const char* option, const char* text) {
+	char* end;
+	const unsigned long long value = strtoull(text, &end, 0);
+
+	if (*text == '\0' || *end != '\0' || *text == '-') {
+		fprintf(stderr, "Error: %s expects a non-negative number, got \"%s\".\n", option, text);
+		exit(EXIT_FAILURE);
+	}
+
+	return value;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2 || strcmp(argv[1], "--help")==0 || strcmp(argv[1], "-h")==0) {
+		show_usage(argv[0]);
+		return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	const char* rom = argv[1];
+	uint64_t frames = DEFAULT_FRAMES;
+	uint64_t cycles = 0; // 0: conta quadros
+	uint64_t seed = 0;
+	uint8_t cycles_per_frame = 0; // 0: o padrão do emulador
+	struct input_script script = { NULL, 0, 0 };
+	FILE* record_file = NULL;
+	FILE* replay_file = NULL;
+	struct movie movie;
+#ifdef EMULATOR_PROFILE
+	const char* profile_file = NULL;
+#endif
+#ifdef EMULATOR_TRACE
+	FILE* trace_file = NULL;
+#endif
+
+	for (int arg=2; arg<argc; arg++) {
+		if (arg + 1 >= argc) {
+			fprintf(stderr, "Error: unknown option or missing value: %s\n", argv[arg]);
+			return EXIT_FAILURE;
+		}
+
+		const char* option = argv[arg];
+		const char* value = argv[++arg];
+
+		if (strcmp(option, "--frames") == 0) {
+			frames = parse_number(option, value);
+			cycles = 0;
+		} else if (strcmp(option, "--cycles") == 0) {
+			cycles = parse_number(option, value);
+		} else if (strcmp(option, "--seed") == 0) {
+			seed = parse_number(option, value);
+		} else if (strcmp(option, "--cycles-per-frame") == 0) {
+			const uint64_t n = parse_number(option, value);
+			if (n == 0 || n > 255) {
+				fprintf(stderr, "Error: cycles per frame amount must be between 1-255.\n");
+				return EXIT_FAILURE;
+			}
+			cycles_per_frame = n;
+		} else if (strcmp(option, "--input") == 0) {
+			input_script_load(&script, value);
+		} else if (strcmp(option, "--record") == 0 || strcmp(option, "--replay") == 0) {
+			const bool record = strcmp(option, "--record") == 0;
+			FILE** file = record ? &record_file : &replay_file;
+			if (*file != NULL) {
+				fclose(*file);
+			}
+			*file = fopen(value, record ? "wb" : "rb");
+			if (*file == NULL) {
+				perror("Failed to open movie");
+				return EXIT_FAILURE;
+			}
+#ifdef EMULATOR_PROFILE
+		} else if (strcmp(option, "--profile") == 0) {
+			profile_file = value;
+#endif
+#ifdef EMULATOR_TRACE
+		} else if (strcmp(option, "--trace") == 0) {
+			if (trace_file != NULL) {
+				fclose(trace_file);
+			}
+			trace_file = fopen(value, "wb");
+			if (trace_file == NULL) {
+				perror("Failed to open trace file");
+				return EXIT_FAILURE;
+			}
+#endif
+		} else {
+			fprintf(stderr, "Error: unknown option: %s\n", option);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (replay_file != NULL) {
+		if (record_file != NULL || cycles != 0 || script.count > 0) {
+			fprintf(stderr, "Error: --replay can't be combined with --record, --cycles or --input.\n");
+			return EXIT_FAILURE;
+		}
+		if (movie_open(&movie, replay_file) != 0) {
+			fprintf(stderr, "Error: not a movie from this version of the emulator.\n");
+			return EXIT_FAILURE;
+		}
+		seed = movie.seed;
+		cycles_per_frame = movie.cycles_per_frame;
+	}
+	// Um filme só guarda quadros inteiros
+	if (record_file != NULL && cycles != 0) {
+		fprintf(stderr, "Error: --record can't be combined with --cycles.\n");
+		return EXIT_FAILURE;
+	}
+
+	const int error = emulator_init(&emulator, rom, seed);
+	if (error != EMULATOR_OK) {
+		fprintf(stderr, "Error: %s: %s.\n", rom, emulator_error_string(error));
+		return EXIT_FAILURE;
+	}
+	if (cycles_per_frame != 0) {
+		emulator.cycles_per_frame = cycles_per_frame;
+	}
+
+	if (replay_file != NULL && emulator_state_hash(&emulator) != movie.start_hash) {
+		fprintf(stderr, "Error: the movie was recorded with a different ROM.\n");
+		return EXIT_FAILURE;
+	}
+	if (record_file != NULL && movie_record(&movie, record_file, &emulator, seed) != 0) {
+		perror("Failed to write movie");
+		return EXIT_FAILURE;
+	}
+
+#ifdef EMULATOR_PROFILE
+	if (profile_file != NULL) {
+		emulator._profile = profile_create();
+		if (emulator._profile == NULL) {
+			fprintf(stderr, "Error: not enough memory for the profiler.\n");
+			return EXIT_FAILURE;
+		}
+	}
+#endif
+
+#ifdef EMULATOR_TRACE
+	if (trace_file != NULL) {
+		emulator._trace = trace_create(trace_file);
+		if (emulator._trace == NULL) {
+			fprintf(stderr, "Error: failed to start the trace writer.\n");
+			return EXIT_FAILURE;
+		}
+	}
+#endif
+
+	uint64_t frame = 0;
+	uint64_t executed = 0;
+	bool fault = false;
+
+	const double start = now();
+
+	for (;;) {
+		if (replay_file != NULL) {
+			uint16_t keys;
+			if (movie_next(&movie, &keys) != 0) {
+				break;
+			}
+			emulator.keys = keys;
+		} else if (cycles != 0 ? executed >= cycles : frame >= frames) {
+			break;
+		} else {
+			emulator.keys = input_script_keys(&script, frame, emulator.keys);
+		}
+
+		if (record_file != NULL && movie_record_frame(&movie, emulator.keys) != 0) {
+			perror("Failed to write movie");
+			return EXIT_FAILURE;
+		}
+
+		// O fim do --cycles pode cair no meio de um quadro: o resto roda sem os timers
+		if (cycles != 0 && cycles - executed < emulator.cycles_per_frame) {
+			while (executed < cycles) {
+				if (emulator_cycle(&emulator) != 0) {
+#ifdef EMULATOR_TRACE
+					if (emulator._trace != NULL) {
+						trace_flush(emulator._trace);
+					}
+#endif
+					fprintf(stderr, "Error: %s at cycle %llu, pc=0x%03X, opcode=%04X.\n",
+						emulator_fault_string(emulator.fault.kind), (unsigned long long)executed,
+						emulator.fault.pc, emulator.fault.opcode);
+					return EXIT_FAILURE;
+				}
+				executed++;
+			}
+			break;
+		}
+
+		if (emulator_tick(&emulator) != 0) {
+			fault = true;
+			break;
+		}
+		executed += emulator.cycles_per_frame;
+		frame++;
+	}
+
+	const double elapsed = now() - start;
+
+	printf("frames: %llu\n", (unsigned long long)frame);
+	printf("cycles: %llu\n", (unsigned long long)executed);
+	printf("time: %.6f s\n", elapsed);
+	printf("mips: %.2f\n", elapsed > 0 ? executed / elapsed / 1e6 : 0.0);
+	printf("screen hash: %016llx\n", (unsigned long long)emulator_screen_hash(&emulator));
+	printf("state hash: %016llx\n", (unsigned long long)emulator_state_hash(&emulator));
+
+	int result = EXIT_SUCCESS;
+	if (fault) {
+		fprintf(stderr, "Error: %s at frame %llu, pc=0x%03X, opcode=%04X.\n", emulator_fault_string(emulator.fault.kind),
+			(unsigned long long)frame, emulator.fault.pc, emulator.fault.opcode);
+		result = EXIT_FAILURE;
+	}
+
+	// O quadro da falha também fica no filme, pra reproduzir a falha
+	if (record_file != NULL && (movie_finish(&movie, &emulator) != 0 || fclose(record_file) != 0)) {
+		perror("Failed to write movie");
+		result = EXIT_FAILURE;
+	}
+
+	if (replay_file != NULL) {
+		const uint64_t replayed = movie.frame;
+		uint16_t keys;
+		while (movie_next(&movie, &keys) == 0) {
+			// O resto de um filme que ia mais longe
+		}
+
+		if (!movie.ended) {
+			fprintf(stderr, "Error: the movie is truncated or corrupt.\n");
+			result = EXIT_FAILURE;
+		} else if (replayed != movie.frames || emulator_state_hash(&emulator) != movie.final_hash) {
+			printf("replay: mismatch after %llu of %llu frames, expected state hash %016llx\n",
+				(unsigned long long)replayed, (unsigned long long)movie.frames, (unsigned long long)movie.final_hash);
+			result = EXIT_FAILURE;
+		} else {
+			printf("replay: ok\n");
+		}
+		fclose(replay_file);
+	}
+
+#ifdef EMULATOR_STATS
+	emulator_print_stats(&emulator, stderr);
+#endif
+
+#ifdef EMULATOR_PROFILE
+	if (emulator._profile != NULL) {
+		FILE* folded = fopen(profile_file, "w");
+		if (folded == NULL || profile_write_folded(emulator._profile, folded) != 0) {
+			perror("Failed to write profile");
+		}
+		if (folded != NULL) {
+			fclose(folded);
+		}
+
+		profile_write_report(emulator._profile, stderr);
+		profile_destroy(emulator._profile);
+	}
+#endif
+
+#ifdef EMULATOR_TRACE
+	if (emulator._trace != NULL) {
+		if (trace_destroy(emulator._trace) != 0 || fclose(trace_file) != 0) {
+			fprintf(stderr, "Error: failed to write the trace.\n");
+			return EXIT_FAILURE;
+		}
+	}
+#endif
+
+	input_script_free(&script);
+	emulator_quit(&emulator);
+
+	return result;
+}
@@ -0,0 +1,109 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#include "input_script.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint16_t parse_keys(const char* text, const char* file, size_t line) {
+	if (strcmp(text, "-") == 0) {
+		return 0;
+	}
+
+	uint16_t keys = 0;
+	for (const char* c=text; *c != '\0'; c++) {
+		if (!isxdigit((unsigned char)*c)) {
+			fprintf(stderr, "Error: %s:%zu: invalid key '%c'. Keys are 0-F.\n", file, line, *c);
+			exit(EXIT_FAILURE);
+		}
+
+		const int key = isdigit((unsigned char)*c) ? *c - '0' : toupper((unsigned char)*c) - 'A' + 10;
+		keys |= 1 << key;
+	}
+
+	return keys;
+}
+
+void input_script_load(struct input_script* script, const char* file) {
+	FILE* input = fopen(file, "r");
+	if (input == NULL) {
+		perror("Failed to open input script");
+		exit(EXIT_FAILURE);
+	}
+
+	char text[256];
+	size_t line = 0;
+	size_t capacity = 0;
+
+	while (fgets(text, sizeof(text), input) != NULL) {
+		line++;
+
+		const char* start = text;
+		while (isspace((unsigned char)*start)) {
+			start++;
+		}
+		if (*start == '\0' || *start == '#') {
+			continue;
+		}
+
+		unsigned long long frame;
+		char keys[17];
+		if (sscanf(start, "%llu %16s", &frame, keys) != 2) {
+			fprintf(stderr, "Error: %s:%zu: expected \"<frame> <keys>\".\n", file, line);
+			exit(EXIT_FAILURE);
+		}
+
+		if (script->count > 0 && frame < script->events[script->count - 1].frame) {
+			fprintf(stderr, "Error: %s:%zu: frames must be in increasing order.\n", file, line);
+			exit(EXIT_FAILURE);
+		}
+
+		if (script->count == capacity) {
+			capacity = capacity == 0 ? 64 : capacity*2;
+			script->events = realloc(script->events, capacity * sizeof(struct input_event));
+			if (script->events == NULL) {
+				perror("Failed to load input script");
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		script->events[script->count].frame = frame;
+		script->events[script->count].keys = parse_keys(keys, file, line);
+		script->count++;
+	}
+
+	fclose(input);
+}
+
+void input_script_free(struct input_script* script) {
+	free(script->events);
+	script->events = NULL;
+	script->count = 0;
+	script->next = 0;
+}
+
+uint16_t input_script_keys(struct input_script* script, uint64_t frame, uint16_t keys) {
+	while (script->next < script->count && script->events[script->next].frame <= frame) {
+		keys = script->events[script->next].keys;
+		script->next++;
+	}
+
+	return keys;
+}
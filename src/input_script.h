@@ -0,0 +1,46 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef INPUT_SCRIPT_H
+#define INPUT_SCRIPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Teclas roteirizadas das ferramentas de linha de comando: uma linha "<quadro> <teclas>" por
+// mudança, em que as teclas são os dígitos hexadecimais das apertadas (ou - pra nenhuma).
+
+// A partir do quadro frame, as teclas apertadas são keys
+struct input_event {
+	uint64_t frame;
+	uint16_t keys;
+};
+
+struct input_script {
+	struct input_event* events;
+	size_t count;
+	size_t next; // Primeiro evento ainda não aplicado
+};
+
+// Lê o roteiro de file. Erros de leitura ou formato terminam o programa com uma mensagem.
+void input_script_load(struct input_script* script, const char* file);
+void input_script_free(struct input_script* script);
+
+// As teclas no quadro frame, dadas as do quadro anterior. Os quadros têm que vir em ordem.
+uint16_t input_script_keys(struct input_script* script, uint64_t frame, uint16_t keys);
+
+#endif
@@ -0,0 +1,624 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+// Pro MAP_ANONYMOUS
+#define _DEFAULT_SOURCE
+
+#include "jit.h"
+
+#if !defined(__x86_64__) || defined(_WIN32)
+#error "The JIT only supports x86-64 with the System V ABI."
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define ARRAY_LEN(arr) (sizeof(arr)/sizeof(arr[0]))
+
+#define ARENA_SIZE (1 << 20)
+#define MAX_BLOCK_LENGTH 32 // Em instruções
+#define MAX_BLOCK_BYTES 2048 // Pior caso de código gerado por um bloco, com folga
+
+// Registradores do x86-64, na ordem da codificação
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// RDI tem o ponteiro pro emulador (primeiro argumento) e RAX, RCX e RDX são rascunho. O resto
+// guarda os registradores do CHIP-8 usados pelo bloco enquanto ele roda.
+static const uint8_t allocatable[] = { RSI, R8, R9, R10, R11, RBX, RBP, R12, R13, R14, R15 };
+
+static bool callee_saved(uint8_t reg) {
+	return reg == RBX || reg == RBP || reg >= R12;
+}
+
+// V0-VF ocupam os slots 0-15
+#define SLOT_I 16
+#define SLOT_COUNT 17
+
+enum block_state {
+	UNCOMPILED=0,
+	COMPILED,
+	UNCOMPILABLE, // A primeira instrução já é do interpretador
+};
+
+struct block {
+	uint8_t state;
+	uint8_t length; // Em instruções
+	uint32_t offset; // Na arena
+};
+
+// A arena nunca é gravável e executável ao mesmo tempo: as páginas de um bloco só viram RW
+// enquanto ele é gerado e voltam pra RX antes de rodar.
+struct jit {
+	uint8_t* arena;
+	size_t used;
+	size_t page_size;
+
+	struct block blocks[MEMORY_SIZE/2];
+};
+
+typedef void (*block_fn)(struct emulator*);
+
+enum kind {
+	UNSUPPORTED,
+	STRAIGHT,
+	TERMINATOR,
+};
+
+#define BIT(slot) (1u << (slot))
+
+// Diz se o opcode pode entrar num bloco e quais slots ele lê/escreve.
+static enum kind classify(uint16_t opcode, uint32_t* used, uint32_t* written) {
+	const uint8_t x = (opcode >> 8) & 0x0F;
+	const uint8_t y = (opcode >> 4) & 0x0F;
+	const uint8_t n = opcode & 0x0F;
+	const uint8_t kk = opcode & 0xFF;
+
+	*used = 0;
+	*written = 0;
+
+	switch (opcode & 0xF000) {
+	case 0x1000:
+		return TERMINATOR;
+	case 0x3000:
+	case 0x4000:
+		*used = BIT(x);
+		return TERMINATOR;
+	case 0x5000:
+	case 0x9000:
+		if (n != 0) {
+			return UNSUPPORTED;
+		}
+		*used = BIT(x) | BIT(y);
+		return TERMINATOR;
+	case 0x6000:
+	case 0x7000:
+		*used = *written = BIT(x);
+		return STRAIGHT;
+	case 0x8000:
+		switch (n) {
+		case 0x0: case 0x1: case 0x2: case 0x3:
+			*used = BIT(x) | BIT(y);
+			*written = BIT(x);
+			return STRAIGHT;
+		case 0x4: case 0x5: case 0x7:
+			*used = BIT(x) | BIT(y) | BIT(0xF);
+			*written = BIT(x) | BIT(0xF);
+			return STRAIGHT;
+		case 0x6: case 0xE:
+			*used = *written = BIT(x) | BIT(0xF);
+			return STRAIGHT;
+		default:
+			return UNSUPPORTED;
+		}
+	case 0xA000:
+		*used = *written = BIT(SLOT_I);
+		return STRAIGHT;
+	case 0xB000:
+		*used = BIT(0);
+		return TERMINATOR;
+	case 0xF000:
+		switch (kk) {
+		case 0x07:
+			*used = *written = BIT(x);
+			return STRAIGHT;
+		case 0x15:
+		case 0x18:
+			*used = BIT(x);
+			return STRAIGHT;
+		case 0x1E:
+			*used = BIT(x) | BIT(SLOT_I);
+			*written = BIT(SLOT_I);
+			return STRAIGHT;
+		default:
+			return UNSUPPORTED;
+		}
+	default:
+		// Dxyn, Fx0A, CALL/RET, memória, teclas e o resto: interpretador
+		return UNSUPPORTED;
+	}
+}
+
+// --- Codificação de instruções x86-64 ---
+
+struct emitter {
+	uint8_t* p;
+};
+
+static void emit8(struct emitter* e, uint8_t byte) {
+	*e->p++ = byte;
+}
+
+static void emit32(struct emitter* e, uint32_t value) {
+	memcpy(e->p, &value, sizeof(value));
+	e->p+=sizeof(value);
+}
+
+// Prefixo REX sem W. force serve pra acessar SIL/DIL/BPL como registradores de 8 bits.
+static void rex(struct emitter* e, uint8_t reg, uint8_t rm, bool force) {
+	const uint8_t prefix = 0x40 | (reg >> 3) << 2 | (rm >> 3);
+	if (prefix != 0x40 || force) {
+		emit8(e, prefix);
+	}
+}
+
+static void modrm(struct emitter* e, uint8_t mod, uint8_t reg, uint8_t rm) {
+	emit8(e, mod << 6 | (reg & 7) << 3 | (rm & 7));
+}
+
+// op r/m32, r32 (mov 0x89, add 0x01, or 0x09, and 0x21, sub 0x29, xor 0x31, cmp 0x39)
+static void emit_rr(struct emitter* e, uint8_t opcode, uint8_t dst, uint8_t src) {
+	rex(e, src, dst, false);
+	emit8(e, opcode);
+	modrm(e, 3, src, dst);
+}
+
+// mov r32, imm32
+static void emit_mov_imm(struct emitter* e, uint8_t dst, uint32_t imm) {
+	rex(e, 0, dst, false);
+	emit8(e, 0xB8 + (dst & 7));
+	emit32(e, imm);
+}
+
+// Grupo 1 com imediato de 32 bits (add /0, and /4, cmp /7)
+enum { ALU_ADD=0, ALU_AND=4, ALU_CMP=7 };
+static void emit_alu_imm(struct emitter* e, uint8_t ext, uint8_t dst, uint32_t imm) {
+	rex(e, 0, dst, false);
+	emit8(e, 0x81);
+	modrm(e, 3, ext, dst);
+	emit32(e, imm);
+}
+
+// Shifts (shl /4, shr /5)
+enum { SHIFT_SHL=4, SHIFT_SHR=5 };
+static void emit_shift(struct emitter* e, uint8_t ext, uint8_t dst, uint8_t count) {
+	rex(e, 0, dst, false);
+	if (count == 1) {
+		emit8(e, 0xD1);
+		modrm(e, 3, ext, dst);
+	} else {
+		emit8(e, 0xC1);
+		modrm(e, 3, ext, dst);
+		emit8(e, count);
+	}
+}
+
+// movzx r32, r8
+static void emit_movzx8(struct emitter* e, uint8_t dst, uint8_t src) {
+	rex(e, dst, src, true);
+	emit8(e, 0x0F);
+	emit8(e, 0xB6);
+	modrm(e, 3, dst, src);
+}
+
+// movzx r32, r16
+static void emit_movzx16(struct emitter* e, uint8_t dst, uint8_t src) {
+	rex(e, dst, src, false);
+	emit8(e, 0x0F);
+	emit8(e, 0xB7);
+	modrm(e, 3, dst, src);
+}
+
+// cmovcc r32, r32 (cmove 0x44, cmovne 0x45)
+enum { CC_E=0x4, CC_NE=0x5, CC_A=0x7 };
+static void emit_cmov(struct emitter* e, uint8_t cc, uint8_t dst, uint8_t src) {
+	rex(e, dst, src, false);
+	emit8(e, 0x0F);
+	emit8(e, 0x40 | cc);
+	modrm(e, 3, dst, src);
+}
+
+// Carrega em dst a flag de "acima" da última comparação (seta cl; movzx dst, cl)
+static void emit_flag_above(struct emitter* e, uint8_t dst) {
+	emit8(e, 0x0F);
+	emit8(e, 0x90 | CC_A);
+	modrm(e, 3, 0, RCX);
+	emit_movzx8(e, dst, RCX);
+}
+
+// movzx r32, byte/word [rdi+disp32]
+static void emit_load(struct emitter* e, uint8_t dst, int32_t disp, bool word) {
+	rex(e, dst, RDI, false);
+	emit8(e, 0x0F);
+	emit8(e, word ? 0xB7 : 0xB6);
+	modrm(e, 2, dst, RDI);
+	emit32(e, (uint32_t)disp);
+}
+
+// mov byte/word [rdi+disp32], r8/r16
+static void emit_store(struct emitter* e, int32_t disp, uint8_t src, bool word) {
+	if (word) {
+		emit8(e, 0x66);
+	}
+	rex(e, src, RDI, !word);
+	emit8(e, word ? 0x89 : 0x88);
+	modrm(e, 2, src, RDI);
+	emit32(e, (uint32_t)disp);
+}
+
+static void emit_push(struct emitter* e, uint8_t reg) {
+	rex(e, 0, reg, false);
+	emit8(e, 0x50 + (reg & 7));
+}
+
+static void emit_pop(struct emitter* e, uint8_t reg) {
+	rex(e, 0, reg, false);
+	emit8(e, 0x58 + (reg & 7));
+}
+
+#define V_OFFSET(x) (int32_t)(offsetof(struct emulator, _v) + (x))
+#define I_OFFSET (int32_t)offsetof(struct emulator, _i)
+#define PC_OFFSET (int32_t)offsetof(struct emulator, _pc)
+#define DT_OFFSET (int32_t)offsetof(struct emulator, _delay_timer)
+#define ST_OFFSET (int32_t)offsetof(struct emulator, _sound_timer)
+
+// Gera uma instrução. Terminadores deixam o próximo PC em EAX. A ordem das operações segue a do
+// emulator_cycle pra que os casos em que x ou y é F deem exatamente o mesmo resultado.
+static void emit_instruction(struct emitter* e, uint16_t opcode, uint16_t pc, const uint8_t* h) {
+	const uint8_t x = (opcode >> 8) & 0x0F;
+	const uint8_t y = (opcode >> 4) & 0x0F;
+	const uint8_t n = opcode & 0x0F;
+	const uint8_t kk = opcode & 0xFF;
+	const uint16_t nnn = opcode & 0x0FFF;
+
+	switch (opcode & 0xF000) {
+	// 1nnn => JP addr
+	case 0x1000:
+		emit_mov_imm(e, RAX, nnn);
+		break;
+	// 3xkk/4xkk => SE/SNE Vx, byte
+	case 0x3000:
+	case 0x4000:
+		emit_mov_imm(e, RAX, pc+2);
+		emit_mov_imm(e, RDX, pc+4);
+		emit_alu_imm(e, ALU_CMP, h[x], kk);
+		emit_cmov(e, (opcode & 0xF000) == 0x3000 ? CC_E : CC_NE, RAX, RDX);
+		break;
+	// 5xy0/9xy0 => SE/SNE Vx, Vy
+	case 0x5000:
+	case 0x9000:
+		emit_mov_imm(e, RAX, pc+2);
+		emit_mov_imm(e, RDX, pc+4);
+		emit_rr(e, 0x39, h[x], h[y]);
+		emit_cmov(e, (opcode & 0xF000) == 0x5000 ? CC_E : CC_NE, RAX, RDX);
+		break;
+	// 6xkk => LD Vx, byte
+	case 0x6000:
+		emit_mov_imm(e, h[x], kk);
+		break;
+	// 7xkk => ADD Vx, byte
+	case 0x7000:
+		emit_alu_imm(e, ALU_ADD, h[x], kk);
+		emit_movzx8(e, h[x], h[x]);
+		break;
+	case 0x8000:
+		switch (n) {
+		// 8xy0 => LD Vx, Vy
+		case 0x0:
+			emit_rr(e, 0x89, h[x], h[y]);
+			break;
+		// 8xy1 => OR Vx, Vy
+		case 0x1:
+			emit_rr(e, 0x09, h[x], h[y]);
+			break;
+		// 8xy2 => AND Vx, Vy
+		case 0x2:
+			emit_rr(e, 0x21, h[x], h[y]);
+			break;
+		// 8xy3 => XOR Vx, Vy
+		case 0x3:
+			emit_rr(e, 0x31, h[x], h[y]);
+			break;
+		// 8xy4 => ADD Vx, Vy
+		case 0x4:
+			emit_rr(e, 0x89, RAX, h[x]);
+			emit_rr(e, 0x01, RAX, h[y]);
+			emit_alu_imm(e, ALU_CMP, RAX, 0xFF);
+			emit_flag_above(e, h[0xF]);
+			emit_rr(e, 0x01, h[x], h[y]);
+			emit_movzx8(e, h[x], h[x]);
+			break;
+		// 8xy5 => SUB Vx, Vy
+		case 0x5:
+			emit_rr(e, 0x39, h[x], h[y]);
+			emit_flag_above(e, h[0xF]);
+			emit_rr(e, 0x29, h[x], h[y]);
+			emit_movzx8(e, h[x], h[x]);
+			break;
+		// 8xy6 => SHR Vx {, Vy}
+		case 0x6:
+			emit_rr(e, 0x89, RCX, h[x]);
+			emit_alu_imm(e, ALU_AND, RCX, 1);
+			emit_rr(e, 0x89, h[0xF], RCX);
+			emit_shift(e, SHIFT_SHR, h[x], 1);
+			break;
+		// 8xy7 => SUBN Vx, Vy
+		case 0x7:
+			emit_rr(e, 0x39, h[y], h[x]);
+			emit_flag_above(e, h[0xF]);
+			emit_rr(e, 0x89, RAX, h[y]);
+			emit_rr(e, 0x29, RAX, h[x]);
+			emit_movzx8(e, h[x], RAX);
+			break;
+		// 8xyE => SHL Vx {, Vy}
+		case 0xE:
+			emit_rr(e, 0x89, RCX, h[x]);
+			emit_shift(e, SHIFT_SHR, RCX, 7);
+			emit_alu_imm(e, ALU_AND, RCX, 1);
+			emit_rr(e, 0x89, h[0xF], RCX);
+			emit_shift(e, SHIFT_SHL, h[x], 1);
+			emit_movzx8(e, h[x], h[x]);
+			break;
+		}
+		break;
+	// Annn => LD I, addr
+	case 0xA000:
+		emit_mov_imm(e, h[SLOT_I], nnn);
+		break;
+	// Bnnn => JP V0, addr
+	case 0xB000:
+		emit_rr(e, 0x89, RAX, h[0]);
+		emit_alu_imm(e, ALU_ADD, RAX, nnn);
+		break;
+	case 0xF000:
+		switch (kk) {
+		// Fx07 => LD Vx, DT
+		case 0x07:
+			emit_load(e, h[x], DT_OFFSET, false);
+			break;
+		// Fx15 => LD DT, Vx
+		case 0x15:
+			emit_store(e, DT_OFFSET, h[x], false);
+			break;
+		// Fx18 => LD ST, Vx
+		case 0x18:
+			emit_store(e, ST_OFFSET, h[x], false);
+			break;
+		// Fx1E => ADD I, Vx
+		case 0x1E:
+			emit_rr(e, 0x01, h[SLOT_I], h[x]);
+			emit_movzx16(e, h[SLOT_I], h[SLOT_I]);
+			break;
+		}
+		break;
+	}
+}
+
+static void flush(struct jit* jit) {
+	memset(jit->blocks, 0, sizeof(jit->blocks));
+	jit->used=0;
+}
+
+// Muda a proteção das páginas que um bloco em code pode ocupar
+static bool protect(struct jit* jit, uint8_t* code, int prot) {
+	const size_t first = (size_t)(code - jit->arena) / jit->page_size * jit->page_size;
+	size_t last = (size_t)(code - jit->arena) + MAX_BLOCK_BYTES;
+	if (last > ARENA_SIZE) {
+		last = ARENA_SIZE;
+	}
+	return mprotect(jit->arena + first, last - first, prot) == 0;
+}
+
+static void compile(struct jit* jit, const struct emulator* emulator, uint16_t start) {
+	struct block* block = &jit->blocks[start/2];
+
+	uint16_t opcodes[MAX_BLOCK_LENGTH];
+	uint8_t length=0;
+	uint32_t used=0;
+	uint32_t written=0;
+	bool terminated=false;
+
+	for (uint16_t pc=start; length<MAX_BLOCK_LENGTH && pc<MEMORY_SIZE-1; pc+=2) {
+		const uint16_t opcode = emulator->_memory[pc] << 8 | emulator->_memory[pc + 1];
+
+		// O interpretador adianta laços ociosos de uma vez só, melhor que qualquer bloco
+		if (emulator_idle_loop(emulator, pc)) {
+			break;
+		}
+
+		uint32_t op_used, op_written;
+		const enum kind kind = classify(opcode, &op_used, &op_written);
+		if (kind == UNSUPPORTED) {
+			break;
+		}
+		// Acabaram os registradores do host
+		if ((size_t)__builtin_popcount(used | op_used) > ARRAY_LEN(allocatable)) {
+			break;
+		}
+
+		used |= op_used;
+		written |= op_written;
+		opcodes[length++] = opcode;
+
+		if (kind == TERMINATOR) {
+			terminated=true;
+			break;
+		}
+	}
+
+	if (length == 0) {
+		block->state = UNCOMPILABLE;
+		return;
+	}
+
+	if (ARENA_SIZE - jit->used < MAX_BLOCK_BYTES) {
+		flush(jit);
+	}
+
+	// Distribui os slots usados pelos registradores do host
+	uint8_t host[SLOT_COUNT] = {0};
+	size_t next=0;
+	for (uint8_t slot=0; slot<SLOT_COUNT; slot++) {
+		if (used & BIT(slot)) {
+			host[slot] = allocatable[next++];
+		}
+	}
+
+	uint8_t* const code = jit->arena + jit->used;
+	if (!protect(jit, code, PROT_READ | PROT_WRITE)) {
+		block->state = UNCOMPILABLE;
+		return;
+	}
+	struct emitter e = { code };
+
+	// Prólogo: salva o que a ABI manda e carrega os registradores do CHIP-8
+	for (size_t r=0; r<next; r++) {
+		if (callee_saved(allocatable[r])) {
+			emit_push(&e, allocatable[r]);
+		}
+	}
+	for (uint8_t slot=0; slot<SLOT_COUNT; slot++) {
+		if (used & BIT(slot)) {
+			emit_load(&e, host[slot], slot == SLOT_I ? I_OFFSET : V_OFFSET(slot), slot == SLOT_I);
+		}
+	}
+
+	for (uint8_t k=0; k<length; k++) {
+		emit_instruction(&e, opcodes[k], start + 2*k, host);
+	}
+
+	// Epílogo: devolve o que mudou e o PC
+	if (!terminated) {
+		emit_mov_imm(&e, RAX, start + 2*length);
+	}
+	emit_store(&e, PC_OFFSET, RAX, true);
+	for (uint8_t slot=0; slot<SLOT_COUNT; slot++) {
+		if (written & BIT(slot)) {
+			emit_store(&e, slot == SLOT_I ? I_OFFSET : V_OFFSET(slot), host[slot], slot == SLOT_I);
+		}
+	}
+	for (size_t r=next; r-- > 0;) {
+		if (callee_saved(allocatable[r])) {
+			emit_pop(&e, allocatable[r]);
+		}
+	}
+	emit8(&e, 0xC3); // ret
+
+	assert(e.p - code <= MAX_BLOCK_BYTES);
+
+	if (!protect(jit, code, PROT_READ | PROT_EXEC)) {
+		block->state = UNCOMPILABLE;
+		return;
+	}
+
+	block->state = COMPILED;
+	block->length = length;
+	block->offset = jit->used;
+	jit->used += e.p - code;
+}
+
+struct jit* jit_create(void) {
+	struct jit* jit = calloc(1, sizeof(struct jit));
+	if (jit == NULL) {
+		return NULL;
+	}
+
+	const long page_size = sysconf(_SC_PAGESIZE);
+	if (page_size <= 0 || ARENA_SIZE % page_size != 0) {
+		free(jit);
+		return NULL;
+	}
+	jit->page_size = page_size;
+
+	// Ainda não tem código pra executar; o compile troca a proteção de cada bloco
+	void* arena = mmap(NULL, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (arena == MAP_FAILED) {
+		free(jit);
+		return NULL;
+	}
+	jit->arena = arena;
+
+	return jit;
+}
+
+void jit_destroy(struct jit* jit) {
+	if (jit == NULL) {
+		return;
+	}
+	munmap(jit->arena, ARENA_SIZE);
+	free(jit);
+}
+
+enum jit_result jit_run(struct jit* jit, struct emulator* emulator, size_t* budget) {
+	const uint16_t pc = emulator->_pc;
+
+	// Endereços ímpares não têm bloco
+	if ((pc & 1) || pc >= MEMORY_SIZE-1) {
+		return JIT_MISS;
+	}
+
+	struct block* block = &jit->blocks[pc/2];
+	if (block->state == UNCOMPILED) {
+		compile(jit, emulator, pc);
+	}
+	if (block->state != COMPILED) {
+		return JIT_MISS;
+	}
+	if (block->length > *budget) {
+		return JIT_SHORT;
+	}
+
+	// ISO C não deixa converter ponteiro de dado pra ponteiro de função diretamente
+	uint8_t* code = jit->arena + block->offset;
+	block_fn fn;
+	memcpy(&fn, &code, sizeof(fn));
+	fn(emulator);
+
+	*budget -= block->length;
+	return JIT_RAN;
+}
+
+void jit_invalidate(struct jit* jit, uint16_t addr, uint16_t len) {
+	// Um bloco que começa em s cobre [s, s+2*length); blocos não compiláveis cobrem só a primeira
+	// instrução.
+	const uint16_t first = addr >= 2*MAX_BLOCK_LENGTH ? addr - 2*MAX_BLOCK_LENGTH : 0;
+
+	for (uint16_t s=first & ~1; s<addr+len && s<MEMORY_SIZE; s+=2) {
+		struct block* block = &jit->blocks[s/2];
+		const uint16_t covered = block->state == COMPILED ? 2*block->length : 2;
+
+		if (block->state != UNCOMPILED && s + covered > addr) {
+			block->state = UNCOMPILED;
+		}
+	}
+}
@@ -0,0 +1,47 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "emulator.h"
+
+// Recompilador de blocos básicos para x86-64. Cada bloco é uma sequência de instruções sem
+// efeitos colaterais fora dos registradores e timers, terminando num salto/pulo ou antes da
+// primeira instrução que o JIT não sabe compilar (que fica pro interpretador).
+
+enum jit_result {
+	JIT_RAN,   // Executou um bloco e descontou do orçamento
+	JIT_MISS,  // Não há bloco nesse PC: o interpretador executa uma instrução
+	JIT_SHORT, // O bloco é maior que o orçamento: o interpretador termina o quadro
+};
+
+struct jit;
+
+// Retorna NULL se não conseguir alocar a memória executável.
+struct jit* jit_create(void);
+void jit_destroy(struct jit* jit);
+
+enum jit_result jit_run(struct jit* jit, struct emulator* emulator, size_t* budget);
+
+// Descarta os blocos que leem algum byte em [addr, addr+len).
+void jit_invalidate(struct jit* jit, uint16_t addr, uint16_t len);
+
+#endif
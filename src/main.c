@@ -22,9 +22,13 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "emulator.h"
 #include "beep.h"
+#include "movie.h"
+#include "pacer.h"
 
 #define SCALE 10
 
@@ -34,16 +38,117 @@ static const char* version="0.2.0";
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
 
+// Uma textura por resolução (64x32 e 128x64), ampliada pelo renderer numa cópia só
+static SDL_Texture *textures[2] = { NULL, NULL };
+
+#define PIXEL_ON 0xFFFFFFFF
+#define PIXEL_OFF 0xFF000000
+
+// Os 8 pixels de cada byte da tela, do bit mais alto pro mais baixo
+static uint32_t byte_pixels[256][8];
+
 struct emulator emulator;
 
+// Gravação ou reprodução de um filme (--record/--replay)
+static struct movie movie;
+static FILE* record_file = NULL;
+static FILE* replay_file = NULL;
+// Reprodução sem esperar os 16 ms de cada quadro
+static bool fast = false;
+
+// Quadros a 60 Hz e as instruções de cada um
+static struct pacer pacer;
+
+// A emulação roda numa thread própria, e a principal só desenha e trata os eventos: um present
+// lento (ou esperando o vsync) não atrasa o emulador. emulation_result fica SDL_APP_CONTINUE
+// enquanto ela roda.
+static SDL_Thread* emulation_thread = NULL;
+static SDL_AtomicInt emulation_stop;
+static SDL_AtomicInt emulation_result;
+
+// Buffer triplo das telas prontas. A emulação escreve em screens[back] e troca com o do meio; o
+// desenho troca o do meio com screens[front] quando tem tela nova (o bit SCREEN_FRESH). Nenhum dos
+// lados espera o outro, e o desenho sempre pega a tela mais recente.
+#define SCREEN_FRESH 4
+struct screen {
+	bool hires;
+	uint64_t rows[EMULATOR_HIRES_HEIGHT][2];
+};
+static struct screen screens[3];
+static int screen_back = 0;
+static SDL_AtomicInt screen_middle;
+static int screen_front = 2;
+
+// A tecla do CHIP-8 de cada scancode; 16 é nenhuma
+static uint8_t scancode_keys[SDL_SCANCODE_COUNT];
+
+// O teclado hexadecimal do COSMAC VIP (1 2 3 C / 4 5 6 D / 7 8 9 E / A 0 B F) nas 4x4 teclas da
+// esquerda, na ordem das teclas 0 a F
+static const char* const default_keymap = "X,1,2,3,Q,W,E,A,S,D,Z,C,4,R,F,V";
+
+// Teclas apertadas e soltas que ainda não entraram num quadro, com o momento do evento. Os
+// eventos chegam na thread principal e saem na da emulação, então a fila tem um mutex.
+struct key_event {
+	uint64_t time;
+	uint8_t key;
+	bool down;
+};
+
+#define KEY_QUEUE_SIZE 64
+static SDL_Mutex* key_mutex = NULL;
+static struct key_event key_queue[KEY_QUEUE_SIZE];
+static size_t key_queue_head = 0;
+static size_t key_queue_count = 0;
+
+// As teclas depois de todos os eventos da fila. Se ela enche, os eventos viram só esse estado,
+// que vale no próximo quadro (key_queue_reset).
+static uint16_t key_queue_keys = 0;
+static bool key_queue_reset = false;
+
 static inline void show_usage(const char* argv0) {
-	printf("%s <rom_file> [ticks_per_frame]\n", argv0);
+	printf("%s <rom_file> [ticks_per_frame] [options]\n", argv0);
+	printf("  --ips N                  instructions per second (default: ticks_per_frame * 60)\n");
+	printf("  --frame-policy POLICY    when frames run late: catch-up (default) or drop\n");
+	printf("  --keymap LIST            keyboard keys for CHIP-8 keys 0-F, comma separated\n");
+	printf("                           (default %s)\n", default_keymap);
+	printf("  --record FILE            record the seed and the keys of every frame to a movie\n");
+	printf("  --replay FILE            replay a movie instead of reading the keyboard\n");
+	printf("  --fast                   replay as fast as possible instead of at 60 frames per second\n");
 }
 
 static inline void show_version(const char *argv0) {
 	printf("%s version %s\n", argv0, version);
 }
 
+// list: os nomes (do SDL) das teclas do teclado pras teclas 0 a F do CHIP-8
+static bool load_keymap(const char* list) {
+	char names[256];
+	if (strlen(list) >= sizeof(names)) {
+		return false;
+	}
+	strcpy(names, list);
+
+	memset(scancode_keys, 16, sizeof(scancode_keys));
+
+	uint8_t key = 0;
+	for (const char* name = strtok(names, ","); name != NULL; name = strtok(NULL, ",")) {
+		const SDL_Scancode scancode = SDL_GetScancodeFromName(name);
+		if (key >= 16 || scancode == SDL_SCANCODE_UNKNOWN) {
+			return false;
+		}
+		scancode_keys[scancode] = key++;
+	}
+
+	return key == 16;
+}
+
+static uint16_t apply_key(uint16_t keys, const struct key_event* event) {
+	if (event->down) {
+		return keys | 1 << event->key;
+	}
+	return keys & ~(1 << event->key);
+}
+
 static void init_emulator(int argc, char* argv[]) {
 	if (argc < 2 || strcmp(argv[1], "--help")==0 || strcmp(argv[1], "-h")==0) {
 		show_usage(argv[0]);
@@ -55,79 +160,360 @@ static void init_emulator(int argc, char* argv[]) {
 		exit(EXIT_SUCCESS);
 	}
 
-	emulator_init(&emulator, argv[1]);
-	beep_init();
-	if (argc >= 3) {
-		const int cycles_per_frame_arg = atoi(argv[2]);
-		if (cycles_per_frame_arg <= 0 || cycles_per_frame_arg > 255) {
+	int cycles_per_frame = 0;
+	int arg = 2;
+	if (argc >= 3 && strncmp(argv[2], "--", 2) != 0) {
+		cycles_per_frame = atoi(argv[2]);
+		if (cycles_per_frame <= 0 || cycles_per_frame > 255) {
 			fprintf(stderr, "Error: cycles per frame amount must be between 1-255.\n");
 			exit(EXIT_FAILURE);
 		}
-		emulator.cycles_per_frame = cycles_per_frame_arg;
+		arg++;
+	}
+
+	long instructions_per_second = 0;
+	enum pacer_policy policy = PACER_CATCH_UP;
+	const char* keymap = default_keymap;
+	for (; arg<argc; arg++) {
+		if (strcmp(argv[arg], "--fast") == 0) {
+			fast = true;
+		} else if (strcmp(argv[arg], "--ips") == 0 && arg + 1 < argc) {
+			instructions_per_second = atol(argv[++arg]);
+			if (instructions_per_second <= 0 || instructions_per_second > 100000000) {
+				fprintf(stderr, "Error: instructions per second must be between 1-100000000.\n");
+				exit(EXIT_FAILURE);
+			}
+		} else if (strcmp(argv[arg], "--keymap") == 0 && arg + 1 < argc) {
+			keymap = argv[++arg];
+		} else if (strcmp(argv[arg], "--frame-policy") == 0 && arg + 1 < argc) {
+			arg++;
+			if (strcmp(argv[arg], "catch-up") == 0) {
+				policy = PACER_CATCH_UP;
+			} else if (strcmp(argv[arg], "drop") == 0) {
+				policy = PACER_DROP;
+			} else {
+				fprintf(stderr, "Error: frame policy must be catch-up or drop.\n");
+				exit(EXIT_FAILURE);
+			}
+		} else if ((strcmp(argv[arg], "--record") == 0 || strcmp(argv[arg], "--replay") == 0) && arg + 1 < argc) {
+			const bool record = strcmp(argv[arg], "--record") == 0;
+			FILE** file = record ? &record_file : &replay_file;
+			*file = fopen(argv[++arg], record ? "wb" : "rb");
+			if (*file == NULL) {
+				perror("Failed to open movie");
+				exit(EXIT_FAILURE);
+			}
+		} else {
+			fprintf(stderr, "Error: unknown option or missing value: %s\n", argv[arg]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (!load_keymap(keymap)) {
+		fprintf(stderr, "Error: the key map must name 16 keys, e.g. %s\n", default_keymap);
+		exit(EXIT_FAILURE);
+	}
+
+	// Um filme guarda instruções por quadro, não por segundo
+	if (instructions_per_second != 0 && (record_file != NULL || replay_file != NULL)) {
+		fprintf(stderr, "Error: --ips can't be combined with movies; use ticks_per_frame.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	uint64_t seed = (uint64_t)time(NULL);
+	if (replay_file != NULL) {
+		if (movie_open(&movie, replay_file) != 0) {
+			fprintf(stderr, "Error: not a movie from this version of the emulator.\n");
+			exit(EXIT_FAILURE);
+		}
+		seed = movie.seed;
+		cycles_per_frame = movie.cycles_per_frame;
 	}
+
+	const int error = emulator_init(&emulator, argv[1], seed);
+	if (error != EMULATOR_OK) {
+		fprintf(stderr, "Error: %s: %s.\n", argv[1], emulator_error_string(error));
+		exit(EXIT_FAILURE);
+	}
+	beep_init();
+	if (cycles_per_frame != 0) {
+		emulator.cycles_per_frame = cycles_per_frame;
+	}
+
+	if (replay_file != NULL && emulator_state_hash(&emulator) != movie.start_hash) {
+		fprintf(stderr, "Error: the movie was recorded with a different ROM.\n");
+		exit(EXIT_FAILURE);
+	}
+	if (record_file != NULL && movie_record(&movie, record_file, &emulator, seed) != 0) {
+		perror("Failed to write movie");
+		exit(EXIT_FAILURE);
+	}
+
+	if (instructions_per_second == 0) {
+		instructions_per_second = emulator.cycles_per_frame * PACER_HZ;
+	}
+	pacer_init(&pacer, SDL_GetTicksNS(), instructions_per_second, policy);
+}
+
+static bool init_renderer(void) {
+	for (int byte=0; byte<256; byte++) {
+		for (int bit=0; bit<8; bit++) {
+			byte_pixels[byte][bit] = byte & (0x80 >> bit) ? PIXEL_ON : PIXEL_OFF;
+		}
+	}
+
+	for (int hires=0; hires<2; hires++) {
+		textures[hires] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_STREAMING,
+			hires ? EMULATOR_HIRES_WIDTH : EMULATOR_WIDTH, hires ? EMULATOR_HIRES_HEIGHT : EMULATOR_HEIGHT);
+		if (textures[hires] == NULL) {
+			return false;
+		}
+
+		// Pixels quadrados, sem borrar
+		SDL_SetTextureScaleMode(textures[hires], SDL_SCALEMODE_NEAREST);
+	}
+	return true;
+}
+
+// Passa a tela pro desenho, trocando o buffer de trás pelo do meio
+static void publish_screen(void) {
+	struct screen* screen = &screens[screen_back];
+	screen->hires = emulator.hires;
+	memcpy(screen->rows, emulator.screen, emulator_height(&emulator) * sizeof(emulator.screen[0]));
+	screen_back = SDL_SetAtomicInt(&screen_middle, screen_back | SCREEN_FRESH) & ~SCREEN_FRESH;
 }
 
-static uint8_t map_scancode_to_key(SDL_Scancode scancode) {
-	switch (scancode) {
-		case SDL_SCANCODE_1: return 0x1; case SDL_SCANCODE_2: return 0x2; case SDL_SCANCODE_3: return 0x3; case SDL_SCANCODE_4: return 0xC;
-		case SDL_SCANCODE_Q: return 0x4; case SDL_SCANCODE_W: return 0x5; case SDL_SCANCODE_E: return 0x6; case SDL_SCANCODE_R: return 0xD;
-		case SDL_SCANCODE_A: return 0x7; case SDL_SCANCODE_S: return 0x8; case SDL_SCANCODE_D: return 0x9; case SDL_SCANCODE_F: return 0xE;
-		case SDL_SCANCODE_Z: return 0xA; case SDL_SCANCODE_X: return 0x0; case SDL_SCANCODE_C: return 0xB; case SDL_SCANCODE_V: return 0xF;
-		default: return 16;
+// Pega a tela mais recente, se tiver uma que ainda não foi desenhada
+static bool take_screen(void) {
+	if (!(SDL_GetAtomicInt(&screen_middle) & SCREEN_FRESH)) {
+		return false;
 	}
+	screen_front = SDL_SetAtomicInt(&screen_middle, screen_front) & ~SCREEN_FRESH;
+	return true;
 }
 
 static void render_emulator(void) {
-	// 1. Definir cor preta e limpar o fundo
-	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	const struct screen* screen = &screens[screen_front];
+	SDL_Texture* texture = textures[screen->hires];
+	const uint8_t width = screen->hires ? EMULATOR_HIRES_WIDTH : EMULATOR_WIDTH;
+	const uint8_t height = screen->hires ? EMULATOR_HIRES_HEIGHT : EMULATOR_HEIGHT;
+
+	void* pixels;
+	int pitch;
+	if (!SDL_LockTexture(texture, NULL, &pixels, &pitch)) {
+		return;
+	}
+
+	// Cada 64 colunas de uma linha são uma palavra: um byte de cada vez vira 8 pixels pela tabela
+	for (uint8_t y=0; y<height; y++) {
+		uint32_t* row = (uint32_t*)((uint8_t*)pixels + y*pitch);
+		for (uint8_t w=0; w<width/64; w++) {
+			const uint64_t line = screen->rows[y][w];
+			for (uint8_t b=0; b<8; b++) {
+				memcpy(row + 64*w + 8*b, byte_pixels[(line >> (56 - 8*b)) & 0xFF], sizeof(byte_pixels[0]));
+			}
+		}
+	}
+
+	SDL_UnlockTexture(texture);
 	SDL_RenderClear(renderer);
+	SDL_RenderTexture(renderer, texture, NULL, NULL);
+}
+
+// Guarda a tecla pro próximo quadro
+static void queue_key(uint64_t time, uint8_t key, bool down) {
+	const struct key_event event = { time, key, down };
+
+	SDL_LockMutex(key_mutex);
+	if (key_queue_count == KEY_QUEUE_SIZE) {
+		key_queue_count = 0;
+		key_queue_reset = true;
+	}
+	key_queue[(key_queue_head + key_queue_count) % KEY_QUEUE_SIZE] = event;
+	key_queue_count++;
+	key_queue_keys = apply_key(key_queue_keys, &event);
+	SDL_UnlockMutex(key_mutex);
+}
 
-	// 2. Definir cor branca para os pixels do emulador
-	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+// Tira da fila os eventos de antes de end, pra não segurar o mutex enquanto emula
+static size_t take_keys(uint64_t end, struct key_event events[KEY_QUEUE_SIZE]) {
+	size_t count = 0;
 
-	for (uint8_t y=0; y<EMULATOR_HEIGHT; y++) {
-	for (uint8_t x=0; x<EMULATOR_WIDTH; x++) {
-		const size_t i = y*EMULATOR_WIDTH + x;
-		const size_t byte = i/8;
-		const uint8_t bit = 7 - (i % 8);
+	SDL_LockMutex(key_mutex);
+	if (key_queue_reset) {
+		// A fila encheu: as teclas ficam como estão agora, desde o começo do quadro
+		emulator.keys = key_queue_keys;
+		key_queue_count = 0;
+		key_queue_reset = false;
+	}
+	while (key_queue_count > 0 && key_queue[key_queue_head].time < end) {
+		events[count++] = key_queue[key_queue_head];
+		key_queue_head = (key_queue_head + 1) % KEY_QUEUE_SIZE;
+		key_queue_count--;
+	}
+	SDL_UnlockMutex(key_mutex);
+
+	return count;
+}
 
-		if (emulator.screen[byte] & 1<<bit) {
-			const SDL_FRect rect = {x*SCALE, y*SCALE, SCALE, SCALE};
-			SDL_RenderFillRect(renderer, &rect);
+static bool run_cycles(size_t cycles) {
+	if (emulator_run(&emulator, cycles) != 0) {
+		fprintf(stderr, "Error: %s at pc=0x%03X, opcode=%04X.\n", emulator_fault_string(emulator.fault.kind),
+			emulator.fault.pc, emulator.fault.opcode);
+		return false;
+	}
+	return true;
+}
+
+// Confere o fim da reprodução com o que foi gravado
+static SDL_AppResult end_replay(void) {
+	if (!movie.ended) {
+		fprintf(stderr, "Error: the movie is truncated or corrupt.\n");
+		return SDL_APP_FAILURE;
+	}
+	if (movie.frame != movie.frames || emulator_state_hash(&emulator) != movie.final_hash) {
+		fprintf(stderr, "Replay mismatch after %llu of %llu frames.\n", (unsigned long long)movie.frame,
+			(unsigned long long)movie.frames);
+		return SDL_APP_FAILURE;
+	}
+	printf("Replay finished: %llu frames, same final state.\n", (unsigned long long)movie.frames);
+	return SDL_APP_SUCCESS;
+}
+
+// O emulator_tick, com as instruções do pacer. Na falha, o SDL_AppQuit ainda fecha o filme.
+static SDL_AppResult run_frame(void) {
+	const struct pacer_frame frame = pacer_next_frame(&pacer);
+
+	struct key_event events[KEY_QUEUE_SIZE];
+	size_t count = 0;
+	if (replay_file != NULL) {
+		uint16_t keys;
+		if (movie_next(&movie, &keys) != 0) {
+			return end_replay();
 		}
+		emulator.keys = keys;
+	} else {
+		count = take_keys(frame.end, events);
 	}
+
+	if (record_file != NULL) {
+		// O filme guarda uma máscara por quadro: as teclas do intervalo valem desde o começo dele
+		for (size_t e=0; e<count; e++) {
+			emulator.keys = apply_key(emulator.keys, &events[e]);
+		}
+		count = 0;
+	}
+
+	if (record_file != NULL && movie_record_frame(&movie, emulator.keys) != 0) {
+		perror("Failed to write movie");
+		return SDL_APP_FAILURE;
+	}
+
+	// Cada tecla entra na instrução proporcional ao momento dela dentro do intervalo do quadro
+	emulator.draw_flag=false;
+	size_t done = 0;
+	for (size_t e=0; e<count; e++) {
+		const uint64_t time = events[e].time;
+		const size_t at = time <= frame.start ? 0 :
+			(time - frame.start) * frame.cycles / (frame.end - frame.start);
+		if (at > done) {
+			if (!run_cycles(at - done)) {
+				return SDL_APP_FAILURE;
+			}
+			done = at;
+		}
+		emulator.keys = apply_key(emulator.keys, &events[e]);
+	}
+	if (!run_cycles(frame.cycles - done)) {
+		return SDL_APP_FAILURE;
+	}
+
+	// O som do quadro sai agora, junto com a imagem; o resto do timer já fica programado
+	if (replay_file == NULL || !fast) {
+		beep_gate(emulator_sound_timer(&emulator));
+	}
+	emulator_end_frame(&emulator);
+
+	if (emulator.draw_flag) {
+		publish_screen();
 	}
+	return SDL_APP_CONTINUE;
 }
 
-static void update_emulator(void) {
-	const bool* keys = SDL_GetKeyboardState(NULL);
-	
-	emulator.keys=0;
-	for (SDL_Scancode key=0; key<SDL_SCANCODE_COUNT; key++) {
-		if (!keys[key]) {
+static int SDLCALL run_emulation(void* data) {
+	(void)data;
+
+	SDL_AppResult result = SDL_APP_CONTINUE;
+	while (result == SDL_APP_CONTINUE && !SDL_GetAtomicInt(&emulation_stop)) {
+		if (fast && replay_file != NULL) {
+			// Reprodução rápida: sem esperar nada, o desenho pega as telas que conseguir
+			result = run_frame();
 			continue;
 		}
-		const uint16_t emulator_key = map_scancode_to_key(key);
 
-		if (emulator_key < 16) {
-			emulator.keys|=(1 << emulator_key);
+		// As teclas são lidas logo antes de cada quadro, e a tela sai logo depois
+		const unsigned frames = pacer_advance(&pacer, SDL_GetTicksNS());
+		for (unsigned f=0; f<frames && result == SDL_APP_CONTINUE; f++) {
+			result = run_frame();
 		}
+
+		// Dorme até o próximo quadro; o SDL_DelayPrecise termina o fim da espera sem dormir
+		SDL_DelayPrecise(pacer_wait(&pacer, SDL_GetTicksNS()));
 	}
 
-	emulator_tick(&emulator);
-	if (emulator.draw_flag) {
+	SDL_SetAtomicInt(&emulation_result, result);
+	return 0;
+}
+
+static bool start_emulation(void) {
+	SDL_SetAtomicInt(&screen_middle, 1);
+	SDL_SetAtomicInt(&emulation_stop, 0);
+	SDL_SetAtomicInt(&emulation_result, SDL_APP_CONTINUE);
+
+	key_mutex = SDL_CreateMutex();
+	if (key_mutex == NULL) {
+		return false;
+	}
+	emulation_thread = SDL_CreateThread(run_emulation, "emulation", NULL);
+	return emulation_thread != NULL;
+}
+
+// Desenha a tela mais recente, ou espera um pouco se não tem nenhuma nova
+static SDL_AppResult update_screen(void) {
+	if (take_screen()) {
 		render_emulator();
 		SDL_RenderPresent(renderer);
-	}
-	if (emulator.beep_flag) {
-		beep_play();
+	} else {
+		SDL_Delay(1);
 	}
 
-	// 60 FPS
-	SDL_Delay(16);
+	return SDL_GetAtomicInt(&emulation_result);
 }
 
 static void quit_emulator(void) {
+	if (emulation_thread != NULL) {
+		SDL_SetAtomicInt(&emulation_stop, 1);
+		SDL_WaitThread(emulation_thread, NULL);
+		emulation_thread = NULL;
+	}
+	if (key_mutex != NULL) {
+		SDL_DestroyMutex(key_mutex);
+		key_mutex = NULL;
+	}
+
+	// O quadro da falha também fica no filme, pra reproduzir a falha
+	if (record_file != NULL && (movie_finish(&movie, &emulator) != 0 || fclose(record_file) != 0)) {
+		perror("Failed to write movie");
+	}
+	if (replay_file != NULL) {
+		fclose(replay_file);
+	}
+
+	pacer_print_stats(&pacer, stderr);
+#ifdef EMULATOR_STATS
+	emulator_print_stats(&emulator, stderr);
+#endif
+	emulator_quit(&emulator);
 	beep_quit();
 }
 
@@ -148,8 +534,18 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 
 	SDL_SetRenderLogicalPresentation(renderer, SCALE*EMULATOR_WIDTH, SCALE*EMULATOR_HEIGHT, SDL_LOGICAL_PRESENTATION_LETTERBOX);
 
+	if (!init_renderer()) {
+		SDL_Log("Couldn't create texture: %s", SDL_GetError());
+		return SDL_APP_FAILURE;
+	}
+
 	init_emulator(argc, argv);
 
+	if (!start_emulation()) {
+		SDL_Log("Couldn't start the emulation thread: %s", SDL_GetError());
+		return SDL_APP_FAILURE;
+	}
+
 	return SDL_APP_CONTINUE;
 }
 
@@ -160,6 +556,15 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 		return SDL_APP_SUCCESS;
 	}
 
+	// Na reprodução as teclas vêm do filme
+	if ((event->type == SDL_EVENT_KEY_DOWN || event->type == SDL_EVENT_KEY_UP) && !event->key.repeat &&
+		replay_file == NULL && event->key.scancode < SDL_SCANCODE_COUNT) {
+		const uint8_t key = scancode_keys[event->key.scancode];
+		if (key < 16) {
+			queue_key(event->key.timestamp, key, event->type == SDL_EVENT_KEY_DOWN);
+		}
+	}
+
 	return SDL_APP_CONTINUE;
 }
 
@@ -167,9 +572,7 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 {
 	(void)appstate;
 
-	update_emulator();
-
-	return SDL_APP_CONTINUE;
+	return update_screen();
 }
 
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
@@ -0,0 +1,158 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#include "movie.h"
+
+#include <string.h>
+
+static void put_le(FILE* out, uint64_t value, int bytes) {
+	for (int b=0; b<bytes; b++) {
+		fputc((value >> (8*b)) & 0xFF, out);
+	}
+}
+
+static int get_le(FILE* in, int bytes, uint64_t* value) {
+	*value = 0;
+	for (int b=0; b<bytes; b++) {
+		const int c = fgetc(in);
+		if (c == EOF) {
+			return 1;
+		}
+		*value |= (uint64_t)c << (8*b);
+	}
+	return 0;
+}
+
+// LEB128: 7 bits por byte, o bit alto diz se tem mais
+static void put_varint(FILE* out, uint64_t value) {
+	while (value >= 0x80) {
+		fputc((value & 0x7F) | 0x80, out);
+		value >>= 7;
+	}
+	fputc(value, out);
+}
+
+static int get_varint(FILE* in, uint64_t* value) {
+	*value = 0;
+	for (int shift=0; shift<64; shift+=7) {
+		const int c = fgetc(in);
+		if (c == EOF) {
+			return 1;
+		}
+		*value |= (uint64_t)(c & 0x7F) << shift;
+		if (!(c & 0x80)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void write_run(struct movie* movie) {
+	if (movie->run_length > 0) {
+		put_varint(movie->file, movie->run_length);
+		put_le(movie->file, movie->run_keys, 2);
+	}
+}
+
+int movie_record(struct movie* movie, FILE* out, const struct emulator* emulator, uint64_t seed) {
+	memset(movie, 0, sizeof(struct movie));
+	movie->file = out;
+	movie->cycles_per_frame = emulator->cycles_per_frame;
+	movie->seed = seed;
+	movie->start_hash = emulator_state_hash(emulator);
+
+	fwrite(MOVIE_MAGIC, 1, sizeof(MOVIE_MAGIC), out);
+	put_le(out, MOVIE_VERSION, 4);
+	put_le(out, movie->cycles_per_frame, 1);
+	put_le(out, movie->seed, 8);
+	put_le(out, movie->start_hash, 8);
+
+	return ferror(out) ? 1 : 0;
+}
+
+int movie_record_frame(struct movie* movie, uint16_t keys) {
+	if (movie->run_length > 0 && keys != movie->run_keys) {
+		write_run(movie);
+		movie->run_length = 0;
+	}
+
+	movie->run_keys = keys;
+	movie->run_length++;
+	movie->frame++;
+
+	return ferror(movie->file) ? 1 : 0;
+}
+
+int movie_finish(struct movie* movie, const struct emulator* emulator) {
+	write_run(movie);
+	movie->run_length = 0;
+
+	put_varint(movie->file, 0);
+	put_le(movie->file, movie->frame, 8);
+	put_le(movie->file, emulator_state_hash(emulator), 8);
+
+	return ferror(movie->file) || fflush(movie->file) != 0 ? 1 : 0;
+}
+
+int movie_open(struct movie* movie, FILE* in) {
+	memset(movie, 0, sizeof(struct movie));
+	movie->file = in;
+
+	char magic[sizeof(MOVIE_MAGIC)];
+	uint64_t version, cycles_per_frame;
+	if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, MOVIE_MAGIC, sizeof(magic)) != 0 ||
+		get_le(in, 4, &version) != 0 || version != MOVIE_VERSION ||
+		get_le(in, 1, &cycles_per_frame) != 0 || cycles_per_frame == 0 ||
+		get_le(in, 8, &movie->seed) != 0 || get_le(in, 8, &movie->start_hash) != 0) {
+		return 1;
+	}
+
+	movie->cycles_per_frame = cycles_per_frame;
+	return 0;
+}
+
+int movie_next(struct movie* movie, uint16_t* keys) {
+	if (movie->ended) {
+		return 1;
+	}
+
+	if (movie->run_length == 0) {
+		uint64_t length, run_keys;
+		if (get_varint(movie->file, &length) != 0) {
+			return 1;
+		}
+
+		if (length == 0) {
+			if (get_le(movie->file, 8, &movie->frames) != 0 || get_le(movie->file, 8, &movie->final_hash) != 0) {
+				return 1;
+			}
+			movie->ended = true;
+			return 1;
+		}
+
+		if (get_le(movie->file, 2, &run_keys) != 0) {
+			return 1;
+		}
+		movie->run_length = length;
+		movie->run_keys = run_keys;
+	}
+
+	*keys = movie->run_keys;
+	movie->run_length--;
+	movie->frame++;
+	return 0;
+}
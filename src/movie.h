@@ -0,0 +1,76 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "emulator.h"
+
+// Filme: a semente e as teclas de cada quadro, que bastam pra repetir uma execução bit a bit.
+//
+// Arquivo (inteiros em little-endian, independente da máquina):
+//   "C8MOVIE\0", versão (u32), instruções por quadro (u8), semente (u64), hash do estado inicial (u64)
+//   sequências de quadros com as mesmas teclas: quantidade (LEB128, >0) e teclas (u16)
+//   0 (LEB128), total de quadros (u64) e hash do estado final (u64)
+//
+// Os hashes deixam a reprodução conferir que a ROM é a mesma e que terminou no mesmo estado.
+
+#define MOVIE_MAGIC "C8MOVIE"
+// 2: o hash do estado inclui o SUPER-CHIP (fonte grande na memória, resolução e flags RPL)
+#define MOVIE_VERSION 2
+
+struct movie {
+	FILE* file; // De quem chamou
+
+	uint8_t cycles_per_frame;
+	uint64_t seed;
+	uint64_t start_hash;
+
+	// Sequência atual: na gravação, ainda não escrita; na reprodução, o que falta dela
+	uint16_t run_keys;
+	uint64_t run_length;
+
+	uint64_t frame; // Quadros gravados ou reproduzidos até agora
+
+	// Lidos no fim da reprodução
+	bool ended;
+	uint64_t frames;
+	uint64_t final_hash;
+};
+
+// Começa a gravar em out, com o emulador já iniciado com seed. Retorna 1 se a escrita falhar.
+int movie_record(struct movie* movie, FILE* out, const struct emulator* emulator, uint64_t seed);
+
+// As teclas do próximo quadro, antes do emulator_tick.
+int movie_record_frame(struct movie* movie, uint16_t keys);
+
+// Fecha a gravação com o estado final do emulador.
+int movie_finish(struct movie* movie, const struct emulator* emulator);
+
+// Lê o cabeçalho de in. Inicie o emulador com movie->seed e movie->cycles_per_frame e confira
+// movie->start_hash. Retorna 1 se in não for um filme desta versão.
+int movie_open(struct movie* movie, FILE* in);
+
+// As teclas do próximo quadro em *keys. Retorna 1 quando o filme acaba (e aí movie->frames e
+// movie->final_hash valem) ou se o arquivo estiver corrompido (movie->ended fica falso).
+int movie_next(struct movie* movie, uint16_t* keys);
+
+#endif
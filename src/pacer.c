@@ -0,0 +1,100 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#include "pacer.h"
+
+#include <math.h>
+#include <string.h>
+
+void pacer_init(struct pacer* pacer, uint64_t now, uint32_t instructions_per_second, enum pacer_policy policy) {
+	memset(pacer, 0, sizeof(struct pacer));
+	pacer->policy = policy;
+	pacer->instructions_per_second = instructions_per_second;
+	pacer->last = now;
+	pacer->origin = now;
+}
+
+unsigned pacer_advance(struct pacer* pacer, uint64_t now) {
+	pacer->accumulator += (now - pacer->last) * PACER_HZ;
+	pacer->last = now;
+
+	uint64_t due = pacer->accumulator / PACER_NS_PER_SECOND;
+	pacer->accumulator %= PACER_NS_PER_SECOND;
+	if (due == 0) {
+		return 0;
+	}
+
+	// O que passou do momento do último quadro devido é o atraso com que o laço acordou
+	const uint64_t late = pacer->accumulator / PACER_HZ;
+	pacer->samples++;
+	pacer->late_sum += late;
+	pacer->late_sum_sq += (double)late * late;
+	if (late > pacer->late_max) {
+		pacer->late_max = late;
+	}
+
+	const uint64_t limit = pacer->policy == PACER_CATCH_UP ? PACER_MAX_CATCH_UP : 1;
+	if (due > limit) {
+		// Os mais antigos ficam pra trás
+		pacer->dropped += due - limit;
+		pacer->slot += due - limit;
+		due = limit;
+	}
+
+	pacer->frames += due;
+	return due;
+}
+
+// Onde começa o intervalo do quadro slot
+static uint64_t slot_start(const struct pacer* pacer, uint64_t slot) {
+	return pacer->origin + slot * PACER_NS_PER_SECOND / PACER_HZ;
+}
+
+struct pacer_frame pacer_next_frame(struct pacer* pacer) {
+	struct pacer_frame frame;
+	frame.start = slot_start(pacer, pacer->slot);
+	frame.end = slot_start(pacer, pacer->slot + 1);
+	pacer->slot++;
+
+	const uint64_t total = (uint64_t)pacer->instructions_per_second + pacer->instruction_remainder;
+	pacer->instruction_remainder = total % PACER_HZ;
+	frame.cycles = total / PACER_HZ;
+	return frame;
+}
+
+uint64_t pacer_wait(const struct pacer* pacer, uint64_t now) {
+	const uint64_t pending = pacer->accumulator + (now - pacer->last) * PACER_HZ;
+	if (pending >= PACER_NS_PER_SECOND) {
+		return 0;
+	}
+	// Arredonda pra cima, pra não acordar um pouco antes e ter que dormir de novo
+	return (PACER_NS_PER_SECOND - pending + PACER_HZ - 1) / PACER_HZ;
+}
+
+void pacer_print_stats(const struct pacer* pacer, FILE* out) {
+	double mean = 0;
+	double stddev = 0;
+	if (pacer->samples > 0) {
+		mean = pacer->late_sum / pacer->samples;
+		const double variance = pacer->late_sum_sq / pacer->samples - mean * mean;
+		stddev = variance > 0 ? sqrt(variance) : 0;
+	}
+
+	fprintf(out, "frames: %llu, dropped: %llu, lateness: mean %.1f us, stddev %.1f us, max %.1f us\n",
+		(unsigned long long)pacer->frames, (unsigned long long)pacer->dropped, mean / 1e3, stddev / 1e3,
+		pacer->late_max / 1e3);
+}
@@ -0,0 +1,92 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Ritmo dos quadros a partir de um relógio monotônico, em nanossegundos (quem chama passa o
+// tempo, então não depende do SDL). O tempo real vai se acumulando e cada 1/60 s vira um quadro,
+// sem arredondar: em 60 s são exatamente 3600 quadros, não importa quando o laço acorda.
+//
+// As instruções por segundo também são exatas: quando não dividem por 60, o resto é espalhado
+// entre os quadros.
+
+#define PACER_HZ 60
+#define PACER_NS_PER_SECOND 1000000000ull
+
+// No máximo quantos quadros atrasados rodam de uma vez. Passando disso (a janela foi arrastada,
+// a máquina dormiu), o resto é descartado em vez de virar uma rajada.
+#define PACER_MAX_CATCH_UP 4
+
+enum pacer_policy {
+	PACER_CATCH_UP, // Roda os quadros atrasados (até PACER_MAX_CATCH_UP): o jogo não fica lento
+	PACER_DROP,     // Roda um quadro e descarta os outros: o jogo fica lento, mas sem saltos
+};
+
+struct pacer {
+	enum pacer_policy policy;
+	uint32_t instructions_per_second;
+
+	// Tempo ainda não transformado em quadros, vezes PACER_HZ (pra 1/60 s ser inteiro)
+	uint64_t last;
+	uint64_t accumulator;
+
+	// O quadro k ocupa o intervalo que começa em origin + k/60 s; slot é o próximo a rodar
+	uint64_t origin;
+	uint64_t slot;
+
+	// O que sobrou da divisão das instruções por segundo pelos quadros
+	uint32_t instruction_remainder;
+
+	uint64_t frames;
+	uint64_t dropped;
+
+	// Atraso do quadro em relação ao momento em que devia ter começado, em ns
+	uint64_t samples;
+	double late_sum;
+	double late_sum_sq;
+	uint64_t late_max;
+};
+
+// Um quadro tirado do pacer: o intervalo de tempo real [start, end) e quantas instruções ele roda.
+// O quadro só roda depois que o intervalo termina, então tudo que aconteceu nele (as teclas, por
+// exemplo) já é conhecido.
+struct pacer_frame {
+	uint64_t start;
+	uint64_t end;
+	size_t cycles;
+};
+
+void pacer_init(struct pacer* pacer, uint64_t now, uint32_t instructions_per_second, enum pacer_policy policy);
+
+// Quantos quadros rodar agora, já aplicada a política.
+unsigned pacer_advance(struct pacer* pacer, uint64_t now);
+
+// O próximo quadro, passando pro seguinte.
+struct pacer_frame pacer_next_frame(struct pacer* pacer);
+
+// Quanto falta, em ns, pro próximo quadro.
+uint64_t pacer_wait(const struct pacer* pacer, uint64_t now);
+
+// Quadros, descartados e o atraso médio, desvio padrão e máximo.
+void pacer_print_stats(const struct pacer* pacer, FILE* out);
+
+#endif
@@ -0,0 +1,239 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#include "profile.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROOT 0
+#define NO_NODE UINT32_MAX
+
+// Quantos endereços o relatório mostra
+#define HOT_ADDRESSES 20
+
+// Um nó por pilha de chamadas distinta. Os filhos sempre são criados depois do pai, então têm
+// índice maior.
+struct node {
+	uint16_t addr; // Destino do CALL
+	uint32_t parent;
+	uint32_t first_child;
+	uint32_t next_sibling;
+	uint64_t self; // Instruções executadas com exatamente essa pilha
+};
+
+struct profile {
+	uint64_t counts[MEMORY_SIZE];
+
+	struct node* nodes;
+	size_t node_count;
+	size_t node_capacity;
+
+	// Nó da pilha atual em cada profundidade. O SP do emulador diz qual vale; o CALL preenche o
+	// próximo e o RET não precisa fazer nada.
+	uint32_t path[STACK_SIZE + 1];
+};
+
+struct profile* profile_create(void) {
+	struct profile* profile = calloc(1, sizeof(struct profile));
+	if (profile == NULL) {
+		return NULL;
+	}
+
+	profile->node_capacity = 64;
+	profile->nodes = malloc(profile->node_capacity * sizeof(struct node));
+	if (profile->nodes == NULL) {
+		free(profile);
+		return NULL;
+	}
+
+	profile->nodes[ROOT] = (struct node){ 0, NO_NODE, NO_NODE, NO_NODE, 0 };
+	profile->node_count = 1;
+
+	// Se o profiler for ligado no meio de uma subrotina, o que vier antes do primeiro CALL fica
+	// na raiz
+	for (uint8_t depth=0; depth<=STACK_SIZE; depth++) {
+		profile->path[depth] = ROOT;
+	}
+
+	return profile;
+}
+
+void profile_destroy(struct profile* profile) {
+	if (profile == NULL) {
+		return;
+	}
+
+	free(profile->nodes);
+	free(profile);
+}
+
+static uint32_t child(struct profile* profile, uint32_t parent, uint16_t addr) {
+	for (uint32_t c=profile->nodes[parent].first_child; c!=NO_NODE; c=profile->nodes[c].next_sibling) {
+		if (profile->nodes[c].addr == addr) {
+			return c;
+		}
+	}
+
+	if (profile->node_count == profile->node_capacity) {
+		struct node* nodes = realloc(profile->nodes, 2 * profile->node_capacity * sizeof(struct node));
+		// Sem memória, a subrotina é contada no chamador
+		if (nodes == NULL) {
+			return parent;
+		}
+		profile->nodes = nodes;
+		profile->node_capacity *= 2;
+	}
+
+	const uint32_t c = profile->node_count++;
+	profile->nodes[c] = (struct node){ addr, parent, NO_NODE, profile->nodes[parent].first_child, 0 };
+	profile->nodes[parent].first_child = c;
+
+	return c;
+}
+
+void profile_step(struct profile* profile, const struct emulator* emulator, const struct emulator_decoded* d) {
+	const uint16_t sp = emulator->_sp;
+
+	profile->counts[emulator->_pc]++;
+	profile->nodes[profile->path[sp]].self++;
+
+	// A instrução de CALL conta no chamador; as seguintes, até o RET (inclusive), na subrotina
+	if (d->op == EMULATOR_OP_CALL && sp + 1 < STACK_SIZE) {
+		profile->path[sp + 1] = child(profile, profile->path[sp], d->nnn);
+	}
+}
+
+void profile_idle(struct profile* profile, const struct emulator* emulator, size_t cycles) {
+	profile->counts[emulator->_pc] += cycles;
+	profile->nodes[profile->path[emulator->_sp]].self += cycles;
+}
+
+uint64_t profile_count(const struct profile* profile, uint16_t addr) {
+	return addr < MEMORY_SIZE ? profile->counts[addr] : 0;
+}
+
+int profile_write_folded(const struct profile* profile, FILE* out) {
+	for (size_t n=0; n<profile->node_count; n++) {
+		if (profile->nodes[n].self == 0) {
+			continue;
+		}
+
+		// Da folha pra raiz, depois impresso ao contrário
+		uint16_t stack[STACK_SIZE];
+		uint8_t depth = 0;
+		for (uint32_t c=n; c!=ROOT; c=profile->nodes[c].parent) {
+			stack[depth++] = profile->nodes[c].addr;
+		}
+
+		fputs("rom", out);
+		while (depth > 0) {
+			fprintf(out, ";0x%03X", stack[--depth]);
+		}
+		fprintf(out, " %llu\n", (unsigned long long)profile->nodes[n].self);
+	}
+
+	return ferror(out) ? 1 : 0;
+}
+
+void profile_write_report(const struct profile* profile, FILE* out) {
+	uint64_t total = 0;
+	for (uint16_t addr=0; addr<MEMORY_SIZE; addr++) {
+		total += profile->counts[addr];
+	}
+	if (total == 0) {
+		fprintf(out, "No instructions profiled.\n");
+		return;
+	}
+
+	fprintf(out, "%-8s %14s %7s\n", "address", "count", "count%");
+	bool shown[MEMORY_SIZE] = { false };
+	for (int line=0; line<HOT_ADDRESSES; line++) {
+		int best = -1;
+		for (uint16_t addr=0; addr<MEMORY_SIZE; addr++) {
+			if (!shown[addr] && profile->counts[addr] > 0 &&
+				(best < 0 || profile->counts[addr] > profile->counts[best])) {
+				best = addr;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+		shown[best] = true;
+
+		fprintf(out, "0x%03X    %14llu %6.2f%%\n", best, (unsigned long long)profile->counts[best],
+			100.0 * profile->counts[best] / total);
+	}
+
+	// Total de cada nó com os descendentes: os filhos têm índice maior, então basta uma passada
+	// de trás pra frente
+	uint64_t* subtree = malloc(profile->node_count * sizeof(uint64_t));
+	if (subtree == NULL) {
+		fprintf(out, "Error: not enough memory for the subroutine report.\n");
+		return;
+	}
+	for (size_t n=0; n<profile->node_count; n++) {
+		subtree[n] = profile->nodes[n].self;
+	}
+	for (size_t n=profile->node_count-1; n>ROOT; n--) {
+		subtree[profile->nodes[n].parent] += subtree[n];
+	}
+
+	// Por subrotina. Na recursão, só a chamada mais externa soma no inclusivo.
+	static uint64_t inclusive[MEMORY_SIZE];
+	static uint64_t exclusive[MEMORY_SIZE];
+	memset(inclusive, 0, sizeof(inclusive));
+	memset(exclusive, 0, sizeof(exclusive));
+
+	for (size_t n=ROOT+1; n<profile->node_count; n++) {
+		const uint16_t addr = profile->nodes[n].addr;
+		exclusive[addr] += profile->nodes[n].self;
+
+		bool outermost = true;
+		for (uint32_t c=profile->nodes[n].parent; c!=ROOT; c=profile->nodes[c].parent) {
+			outermost &= profile->nodes[c].addr != addr;
+		}
+		if (outermost) {
+			inclusive[addr] += subtree[n];
+		}
+	}
+
+	fprintf(out, "\n%-10s %14s %7s %14s %7s\n", "subroutine", "inclusive", "incl%", "exclusive", "excl%");
+	fprintf(out, "%-10s %14llu %6.2f%% %14llu %6.2f%%\n", "rom", (unsigned long long)subtree[ROOT], 100.0,
+		(unsigned long long)profile->nodes[ROOT].self, 100.0 * profile->nodes[ROOT].self / total);
+
+	memset(shown, 0, sizeof(shown));
+	for (;;) {
+		int best = -1;
+		for (uint16_t addr=0; addr<MEMORY_SIZE; addr++) {
+			if (!shown[addr] && inclusive[addr] > 0 && (best < 0 || inclusive[addr] > inclusive[best])) {
+				best = addr;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+		shown[best] = true;
+
+		fprintf(out, "0x%03X      %14llu %6.2f%% %14llu %6.2f%%\n", best,
+			(unsigned long long)inclusive[best], 100.0 * inclusive[best] / total,
+			(unsigned long long)exclusive[best], 100.0 * exclusive[best] / total);
+	}
+
+	free(subtree);
+}
@@ -0,0 +1,53 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "emulator.h"
+
+// Profiler do programa emulado (só com PROFILE=1). Conta as instruções executadas em cada
+// endereço e em cada pilha de chamadas, seguindo os CALL/RET. As subrotinas são identificadas
+// pelo endereço de destino do CALL; o que roda fora de qualquer CALL fica na raiz "rom".
+
+struct profile;
+
+// Retorna NULL se faltar memória. Ligue com emulator->_profile = profile.
+struct profile* profile_create(void);
+void profile_destroy(struct profile* profile);
+
+// Chamado pelo interpretador antes de executar cada instrução.
+void profile_step(struct profile* profile, const struct emulator* emulator, const struct emulator_decoded* d);
+
+// Ciclos que um laço ocioso pulou de uma vez, contados no PC atual.
+void profile_idle(struct profile* profile, const struct emulator* emulator, size_t cycles);
+
+// Instruções executadas no endereço addr.
+uint64_t profile_count(const struct profile* profile, uint16_t addr);
+
+// Uma linha "rom;0x2A0;0x310 N" por pilha, no formato do flamegraph.pl. Retorna 1 se a escrita
+// falhar.
+int profile_write_folded(const struct profile* profile, FILE* out);
+
+// Os endereços mais executados e o custo inclusivo e exclusivo de cada subrotina.
+void profile_write_report(const struct profile* profile, FILE* out);
+
+#endif
@@ -15,9 +15,27 @@
 	see <https://www.gnu.org/licenses/>. 
 */
 
+// mkstemp
+#define _POSIX_C_SOURCE 200809L
+
 #include "unity.h"
 #include "emulator.h"
+#include "batch.h"
+#include "c8emu.h"
+#include "movie.h"
+#include "pacer.h"
+#ifdef EMULATOR_JIT
+#include "jit.h"
+#endif
+#ifdef EMULATOR_PROFILE
+#include "profile.h"
+#endif
+#ifdef EMULATOR_TRACE
+#include "trace.h"
+#endif
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 struct emulator emu;
 
@@ -27,10 +45,12 @@ void setUp(void) {
 	memset(&emu, 0, sizeof(struct emulator));
 	emu._pc = 0x200; 
 	emu.cycles_per_frame = 16;
+	emulator_seed(&emu, 0);
 }
 
 void tearDown(void) {
 	// Limpeza após cada teste, se necessário
+	emulator_quit(&emu);
 }
 
 // Auxiliar para carregar um opcode de 2 bytes na memória na posição atual do PC
@@ -108,8 +128,8 @@ void test_opcode_2nnn_and_00EE_call_return(void) {
 
 void test_opcode_dxyn_draw_sets_collision(void) {
 	// Configura um pixel no buffer da tela
-	// A largura geralmente é 64, então byte 0, bit 0x80 é a coordenada (0,0)
-	emu.screen[0] = 0x80; 
+	// Cada linha são duas palavras de 64 bits e o bit mais alto da primeira é a coordenada (0,0)
+	emu.screen[0][0] = (uint64_t)1 << 63;
 	emu._v[0] = 0; // x
 	emu._v[1] = 0; // y
 	emu._i = 0x400;
@@ -120,12 +140,147 @@ void test_opcode_dxyn_draw_sets_collision(void) {
 	
 	emulator_cycle(&emu);
 	
-	// Fazer XOR de 0x80 com 0x80 deve resultar em 0 (colisão detectada)
-	TEST_ASSERT_EQUAL_UINT8(0, emu.screen[0]);
+	// Fazer XOR do pixel com ele mesmo deve resultar em 0 (colisão detectada)
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 0, 0));
 	TEST_ASSERT_EQUAL_UINT8(1, emu._v[0xF]);
 	TEST_ASSERT_TRUE(emu.draw_flag);
 }
 
+void test_opcode_dxyn_draw_wraps_around(void) {
+	// Sprite de 2 linhas 11111111 em (60, 31): as duas bordas dão a volta
+	emu._v[0] = 60;
+	emu._v[1] = 31;
+	emu._i = 0x400;
+	emu._memory[0x400] = 0xFF;
+	emu._memory[0x401] = 0x81;
+
+	load_opcode(0xD012);
+	emulator_cycle(&emu);
+
+	TEST_ASSERT_EQUAL_UINT8(0, emu._v[0xF]);
+	for (uint8_t x=0; x<EMULATOR_WIDTH; x++) {
+		TEST_ASSERT_EQUAL(x >= 60 || x < 4, emulator_pixel(&emu, x, 31));
+	}
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 60, 0));
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 3, 0));
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 61, 0));
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 2, 0));
+	TEST_ASSERT_EQUAL_UINT64(0, emu.screen[1][0]);
+}
+
+void test_schip_hires_sprite_clips_and_counts_rows(void) {
+	// HIGH; DRW V0, V1, 0 duas vezes; DRW V2, V3, 0
+	const uint16_t program[] = { 0x00FF, 0xD010, 0xD010, 0xD230 };
+	for (uint8_t j=0; j<4; j++) {
+		emu._memory[0x200 + 2*j] = program[j] >> 8;
+		emu._memory[0x201 + 2*j] = program[j] & 0xFF;
+	}
+	emu._i = 0x400;
+	memset(emu._memory + 0x400, 0xFF, 32);
+	emu._v[0] = 120;
+	emu._v[1] = 62;
+	emu._v[2] = 56;
+	emu._v[3] = 10;
+
+	emulator_cycle(&emu);
+	TEST_ASSERT_TRUE(emu.hires);
+	TEST_ASSERT_EQUAL_UINT8(EMULATOR_HIRES_WIDTH, emulator_width(&emu));
+
+	// O sprite de 16x16 no canto é cortado, sem dar a volta, e as 14 linhas cortadas contam em VF
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT8(14, emu._v[0xF]);
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 120, 62));
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 127, 63));
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 0, 62));
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 120, 0));
+
+	// Só as duas linhas visíveis colidem, mais as mesmas 14 cortadas
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT8(16, emu._v[0xF]);
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 127, 63));
+
+	// Passando da coluna 63 pra segunda palavra
+	emulator_cycle(&emu);
+	for (uint8_t x=50; x<80; x++) {
+		TEST_ASSERT_EQUAL(x >= 56 && x < 72, emulator_pixel(&emu, x, 10));
+	}
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 71, 25));
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 71, 26));
+}
+
+void test_schip_hires_sprite_counts_rows_clipped_at_bottom(void) {
+	// HIGH; DRW V0, V1, 5
+	load_opcode(0x00FF);
+	emulator_cycle(&emu);
+
+	emu._i = 0x400;
+	memset(emu._memory + 0x400, 0x80, 5);
+	emu._v[0] = 10;
+	emu._v[1] = 61;
+	load_opcode(0xD015);
+	emulator_cycle(&emu);
+
+	// Três linhas desenhadas, sem colisão; as duas que passam da linha 63 vão pro VF
+	TEST_ASSERT_EQUAL_UINT8(2, emu._v[0xF]);
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 10, 63));
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 10, 0));
+
+	// Colisão nas três de novo: 3 + 2
+	emu._pc -= 2;
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT8(5, emu._v[0xF]);
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 10, 63));
+}
+
+void test_schip_scroll_and_rpl_flags(void) {
+	// HIGH; SCR; SCL; SCD 3; LOW; SCR; LD HF, V0; LD R, V2; LD V2, R
+	const uint16_t program[] = { 0x00FF, 0x00FB, 0x00FC, 0x00C3, 0x00FE, 0x00FB, 0xF030, 0xF275, 0xF285 };
+	for (uint8_t j=0; j<9; j++) {
+		emu._memory[0x200 + 2*j] = program[j] >> 8;
+		emu._memory[0x201 + 2*j] = program[j] & 0xFF;
+	}
+
+	emulator_cycle(&emu);
+	emu.screen[0][0] = (uint64_t)1 << 1; // (62, 0)
+
+	emulator_cycle(&emu);
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 62, 0));
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 66, 0));
+
+	emulator_cycle(&emu);
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 62, 0));
+	TEST_ASSERT_EQUAL_UINT64(0, emu.screen[0][1]);
+
+	emulator_cycle(&emu);
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 62, 0));
+	TEST_ASSERT_TRUE(emulator_pixel(&emu, 62, 3));
+
+	// Trocar a resolução apaga a tela; na baixa, o que sai pela direita some
+	emulator_cycle(&emu);
+	TEST_ASSERT_FALSE(emu.hires);
+	TEST_ASSERT_FALSE(emulator_pixel(&emu, 62, 3));
+	emu.screen[5][0] = 1; // (63, 5)
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT64(0, emu.screen[5][0]);
+	TEST_ASSERT_EQUAL_UINT64(0, emu.screen[5][1]);
+
+	// A fonte grande vem logo depois da pequena, 10 bytes por dígito
+	emu._v[0] = 7;
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT16(80 + 7*10, emu._i);
+
+	emu._v[0] = 1;
+	emu._v[1] = 2;
+	emu._v[2] = 3;
+	emulator_cycle(&emu);
+	memset(emu._v, 0, sizeof(emu._v));
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT8(1, emu._v[0]);
+	TEST_ASSERT_EQUAL_UINT8(2, emu._v[1]);
+	TEST_ASSERT_EQUAL_UINT8(3, emu._v[2]);
+	TEST_ASSERT_EQUAL_UINT8(0, emu._v[3]);
+}
+
 // --- Testes de Segurança e Tratamento de Erros ---
 
 void test_stack_overflow_protection(void) {
@@ -375,6 +530,52 @@ void test_opcode_Fx29_font_character_pointer(void) {
 	TEST_ASSERT_EQUAL_UINT16(50, emu._i);
 }
 
+void test_opcode_Cxkk_is_deterministic_per_seed(void) {
+	static struct emulator other;
+	uint8_t first[32];
+
+	// C0FF (RND V0, 0xFF); 1200 (JP 0x200)
+	load_opcode(0xC0FF);
+	emu._memory[0x202] = 0x12;
+	emu._memory[0x203] = 0x00;
+	other = emu;
+
+	bool varied = false;
+	for (uint8_t j=0; j<32; j++) {
+		emulator_cycle(&emu);
+		emulator_cycle(&emu);
+		first[j] = emu._v[0];
+		varied |= first[j] != first[0];
+	}
+	TEST_ASSERT_TRUE(varied);
+
+	// Mesma semente, mesma sequência
+	for (uint8_t j=0; j<32; j++) {
+		emulator_cycle(&other);
+		emulator_cycle(&other);
+		TEST_ASSERT_EQUAL_UINT8(first[j], other._v[0]);
+	}
+
+	// Semente diferente, outra sequência
+	emulator_seed(&other, 1);
+	bool differs = false;
+	for (uint8_t j=0; j<32; j++) {
+		emulator_cycle(&other);
+		emulator_cycle(&other);
+		differs |= first[j] != other._v[0];
+	}
+	TEST_ASSERT_TRUE(differs);
+
+	// O kk continua sendo uma máscara
+	emu._memory[0x204] = 0xC0;
+	emu._memory[0x205] = 0x0F;
+	for (uint8_t j=0; j<32; j++) {
+		emu._pc = 0x204;
+		emulator_cycle(&emu);
+		TEST_ASSERT_EQUAL_UINT8(0, emu._v[0] & 0xF0);
+	}
+}
+
 void test_chained_skips(void) {
 	// Configuração: V0=1, V1=1. 
 	// Programa:
@@ -392,6 +593,817 @@ void test_chained_skips(void) {
 	TEST_ASSERT_EQUAL_UINT16(0x204, emu._pc);
 }
 
+void test_fx55_invalidates_decoded_instruction(void) {
+	// 0x200: 6105 (LD V1, 0x05), executada uma vez pra entrar no cache
+	load_opcode(0x6105);
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT8(0x05, emu._v[1]);
+
+	// 0x202: F155 (LD [I], V1) sobrescreve 0x200 com V0=0x61 e V1=0x07
+	emu._i = 0x200;
+	emu._v[0] = 0x61;
+	emu._v[1] = 0x07;
+	load_opcode(0xF155);
+	emulator_cycle(&emu);
+
+	// De volta em 0x200 deve executar a instrução nova (LD V1, 0x07)
+	emu._pc = 0x200;
+	emu._v[1] = 0;
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT8(0x07, emu._v[1]);
+}
+
+void test_fx33_invalidates_decoded_instruction(void) {
+	// 0x300: 6AFF (LD VA, 0xFF), executada uma vez
+	emu._pc = 0x300;
+	load_opcode(0x6AFF);
+	emulator_cycle(&emu);
+
+	// BCD de 123 em 0x301 vira 6A01 02..., ou seja LD VA, 0x01
+	emu._pc = 0x200;
+	emu._i = 0x301;
+	emu._v[0] = 123;
+	load_opcode(0xF033);
+	emulator_cycle(&emu);
+
+	emu._pc = 0x300;
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT8(0x01, emu._v[0xA]);
+}
+
+void test_odd_pc_executes(void) {
+	// Bnnn pode levar o PC pra um endereço ímpar
+	emu._v[0] = 1;
+	load_opcode(0xB300); // JP V0, 0x300
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT16(0x301, emu._pc);
+
+	load_opcode(0x6642); // LD V6, 0x42
+	emulator_cycle(&emu);
+	TEST_ASSERT_EQUAL_UINT8(0x42, emu._v[6]);
+	TEST_ASSERT_EQUAL_UINT16(0x303, emu._pc);
+}
+
+void test_idle_loops_match_stepping(void) {
+	static struct emulator stepped;
+
+	// 0x200: F107 (LD V1, DT); 3100 (SE V1, 0); 1200 (JP 0x200); 6242 (LD V2, 0x42); 1208 (JP 0x208)
+	static const uint8_t program[] = { 0xF1, 0x07, 0x31, 0x00, 0x12, 0x00, 0x62, 0x42, 0x12, 0x08 };
+
+	// Com 15, 16 e 17 ciclos o quadro acaba em cada uma das três instruções do laço
+	for (uint8_t cycles=15; cycles<=17; cycles++) {
+		setUp();
+		memcpy(emu._memory + 0x200, program, sizeof(program));
+		emu._delay_timer = 5;
+		emu.cycles_per_frame = cycles;
+		stepped = emu;
+
+		TEST_ASSERT_TRUE(emulator_idle_loop(&emu, 0x200));
+		TEST_ASSERT_TRUE(emulator_idle_loop(&emu, 0x208));
+		TEST_ASSERT_FALSE(emulator_idle_loop(&emu, 0x206));
+
+		for (int frame=0; frame<8; frame++) {
+			emulator_tick(&emu);
+
+			// Um ciclo por vez nunca adianta nada
+			for (uint8_t c=0; c<cycles; c++) {
+				emulator_cycle(&stepped);
+			}
+			if (stepped._delay_timer > 0) {
+				stepped._delay_timer--;
+			}
+
+			TEST_ASSERT_EQUAL_UINT16(stepped._pc, emu._pc);
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(stepped._v, emu._v, 16);
+			TEST_ASSERT_EQUAL_UINT8(stepped._delay_timer, emu._delay_timer);
+		}
+
+		// O laço terminou e o programa parou no JP pra si mesmo
+		TEST_ASSERT_EQUAL_UINT8(0x42, emu._v[2]);
+		TEST_ASSERT_EQUAL_UINT16(0x208, emu._pc);
+	}
+}
+
+void test_run_in_pieces_matches_tick(void) {
+	static struct emulator split;
+
+	// O mesmo laço do delay timer do teste anterior
+	static const uint8_t program[] = { 0xF1, 0x07, 0x31, 0x00, 0x12, 0x00, 0x62, 0x42, 0x12, 0x08 };
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+	emu._delay_timer = 5;
+	split = emu;
+
+	for (int frame=0; frame<8; frame++) {
+		emulator_tick(&emu);
+
+		// O quadro quebrado num ponto qualquer do laço
+		TEST_ASSERT_EQUAL_INT(0, emulator_run(&split, 7));
+		TEST_ASSERT_EQUAL_INT(0, emulator_run(&split, split.cycles_per_frame - 7));
+		emulator_end_frame(&split);
+
+		TEST_ASSERT_EQUAL_UINT16(emu._pc, split._pc);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(emu._v, split._v, 16);
+		TEST_ASSERT_EQUAL_UINT8(emu._delay_timer, split._delay_timer);
+	}
+
+	// A falha para no PC da instrução, sem sair do programa
+	split._memory[0x300] = 0xE1;
+	split._memory[0x301] = 0xFF;
+	split._pc = 0x300;
+	TEST_ASSERT_EQUAL_INT(1, emulator_run(&split, 16));
+	TEST_ASSERT_EQUAL_UINT16(0x300, split._pc);
+}
+
+void test_reset_loads_new_rom_in_place(void) {
+	// LD V1, 0x11; CALL 0x206; ...; 0x206: ADD V1, 1
+	static const uint8_t first[] = { 0x61, 0x11, 0x22, 0x06, 0x00, 0x00, 0x71, 0x01 };
+	// Mesmo começo, mas LD V2 no lugar do CALL
+	static const uint8_t second[] = { 0x61, 0x11, 0x62, 0x22 };
+
+	TEST_ASSERT_EQUAL_INT(0, emulator_reset(&emu, first, sizeof(first), 1));
+	emulator_tick(&emu);
+	TEST_ASSERT_EQUAL_UINT16(1, emu._sp);
+
+	TEST_ASSERT_EQUAL_INT(0, emulator_reset(&emu, second, sizeof(second), 1));
+	TEST_ASSERT_EQUAL_UINT16(0x200, emu._pc);
+	TEST_ASSERT_EQUAL_UINT16(0, emu._sp);
+	TEST_ASSERT_EQUAL_UINT8(0, emu._v[1]);
+	// O resto da ROM anterior some da memória
+	TEST_ASSERT_EQUAL_HEX8(0x00, emu._memory[0x206]);
+	TEST_ASSERT_EQUAL_HEX8(0xF0, emu._memory[0]);
+
+	// A instrução em 0x202 já estava decodificada como CALL
+	TEST_ASSERT_EQUAL_INT(0, emulator_cycle(&emu));
+	TEST_ASSERT_EQUAL_INT(0, emulator_cycle(&emu));
+	TEST_ASSERT_EQUAL_UINT8(0x22, emu._v[2]);
+	TEST_ASSERT_EQUAL_UINT16(0, emu._sp);
+
+	// A mesma semente dá o mesmo gerador
+	static struct emulator seeded;
+	emulator_seed(&seeded, 1);
+	TEST_ASSERT_EQUAL_HEX32_ARRAY(seeded._rng, emu._rng, 4);
+
+	static uint8_t big[MEMORY_SIZE - MEMORY_START + 1];
+	TEST_ASSERT_EQUAL_INT(EMULATOR_ERROR_TOO_BIG, emulator_reset(&emu, big, sizeof(big), 0));
+
+	// ROM vazia, sem buffer nenhum: só a fonte fica na memória
+	TEST_ASSERT_EQUAL_INT(EMULATOR_OK, emulator_reset(&emu, NULL, 0, 0));
+	TEST_ASSERT_EQUAL_HEX8(0x00, emu._memory[0x200]);
+	TEST_ASSERT_EQUAL_HEX8(0xF0, emu._memory[0]);
+}
+
+void test_batch_matches_single_instances(void) {
+	static struct emulator single;
+	static struct emulator_batch batch;
+
+	// Começa com todas as instâncias juntas: ALU com VF como destino e origem, um Fx55 que reescreve
+	// o operando da instrução seguinte (que aí tem opcodes diferentes no mesmo PC), um skip e um
+	// Bnnn que manda cada uma pra um lugar. Depois disso elas seguem separadas, com skips que
+	// dependem de V0, CALL/RET, BCD, Fx65 e Dxyn.
+	static const uint16_t program[] = {
+		0x6103, 0x8F14, 0x81F5, 0x8016, 0x830E, 0x6506, 0x8650, 0x8602, // 0x200
+		0xA215, 0xF055, 0x6A00, 0x3506, 0x7701, 0x7801, 0xA300, 0xF31E, // 0x210
+		0xF615, 0x8060, 0xB22C, 0x0000, 0x0000, 0x0000, 0x7902, 0x7902, // 0x220
+		0x7902, 0x7902, 0x8014, 0x3F01, 0x7205, 0x8E07, 0x3E10, 0x224C, // 0x230
+		0xF033, 0xF265, 0xD011, 0x7311, 0x1234, 0x0000, 0xF407, 0xF318, // 0x240
+		0xA255, 0xF055, 0x6B00, 0xA380, 0x00EE,                         // 0x250
+	};
+	for (size_t j=0; j<sizeof(program)/sizeof(program[0]); j++) {
+		emu._memory[0x200 + 2*j] = program[j] >> 8;
+		emu._memory[0x200 + 2*j + 1] = program[j] & 0xFF;
+	}
+
+	// Quantidade que não é múltipla do vetor
+	const size_t count = 37;
+	TEST_ASSERT_EQUAL_INT(0, emulator_batch_init(&batch, &emu, count));
+
+	for (size_t k=0; k<count; k++) {
+		batch.v[0][k] = k*7;
+		batch.v[3][k] = k*3;
+	}
+	for (int frame=0; frame<30; frame++) {
+		emulator_batch_tick(&batch);
+	}
+	emulator_batch_sync(&batch);
+
+	for (size_t k=0; k<count; k++) {
+		single = emu;
+		single._v[0] = k*7;
+		single._v[3] = k*3;
+		for (int frame=0; frame<30; frame++) {
+			emulator_tick(&single);
+		}
+
+		const struct emulator* lane = &batch.instances[k];
+		TEST_ASSERT_FALSE(batch.faulted[k]);
+		TEST_ASSERT_EQUAL_UINT16(single._pc, lane->_pc);
+		TEST_ASSERT_EQUAL_UINT16(single._i, lane->_i);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(single._v, lane->_v, 16);
+		TEST_ASSERT_EQUAL_UINT8(single._sp, lane->_sp);
+		TEST_ASSERT_EQUAL_UINT8(single._delay_timer, lane->_delay_timer);
+		TEST_ASSERT_EQUAL_UINT8(single._sound_timer, lane->_sound_timer);
+		TEST_ASSERT_EQUAL(single.draw_flag, lane->draw_flag);
+		TEST_ASSERT_EQUAL(single.beep_flag, lane->beep_flag);
+		TEST_ASSERT_EQUAL_MEMORY(single._memory, lane->_memory, MEMORY_SIZE);
+		TEST_ASSERT_EQUAL_MEMORY(single.screen, lane->screen, sizeof(single.screen));
+		emulator_quit(&single);
+	}
+
+	emulator_batch_free(&batch);
+}
+
+void test_batch_keeps_vectors_after_a_fault(void) {
+	static struct emulator_batch batch;
+
+	// 0x200: 3000 (SE V0, 0); 00EE (RET, falha com a stack vazia); 7101 (ADD V1, 1); 1204 (JP 0x204)
+	static const uint16_t program[] = { 0x3000, 0x00EE, 0x7101, 0x1204 };
+	for (size_t j=0; j<sizeof(program)/sizeof(program[0]); j++) {
+		emu._memory[0x200 + 2*j] = program[j] >> 8;
+		emu._memory[0x200 + 2*j + 1] = program[j] & 0xFF;
+	}
+
+	const size_t count = 20;
+	TEST_ASSERT_EQUAL_INT(0, emulator_batch_init(&batch, &emu, count));
+
+	// Só a instância 3 passa pelo RET
+	batch.v[0][3] = 1;
+	emulator_batch_step(&batch, 20);
+	TEST_ASSERT_TRUE(batch.faulted[3]);
+
+	// As outras voltaram a andar juntas. O caminho vetorial não passa pelas instâncias, então
+	// elas ficam com os registradores de antes até o sync.
+	emulator_batch_step(&batch, 100);
+	for (size_t k=0; k<count; k++) {
+		if (k != 3) {
+			TEST_ASSERT_FALSE(batch.faulted[k]);
+			TEST_ASSERT_NOT_EQUAL(batch.v[1][k], batch.instances[k]._v[1]);
+		}
+	}
+
+	emulator_batch_sync(&batch);
+	for (size_t k=0; k<count; k++) {
+		const struct emulator* lane = &batch.instances[k];
+		if (k == 3) {
+			// A que falhou ficou parada no RET
+			TEST_ASSERT_EQUAL_UINT16(0x202, lane->_pc);
+			TEST_ASSERT_EQUAL_UINT8(0, lane->_v[1]);
+		} else {
+			// SE, e aí ADD e JP alternando nos 119 ciclos seguintes
+			TEST_ASSERT_EQUAL_UINT16(0x206, lane->_pc);
+			TEST_ASSERT_EQUAL_UINT8(60, lane->_v[1]);
+		}
+	}
+
+	emulator_batch_free(&batch);
+}
+
+#ifdef EMULATOR_PROFILE
+void test_batch_lanes_leave_the_prototype_profile_alone(void) {
+	static struct emulator_batch batch;
+
+	// 3000 (SE V0, 0); 2208 (CALL 0x208); 7001 (ADD V0, 1); 1200 (JP 0x200); 0x208: 00EE (RET).
+	// Só a instância 1 faz o CALL, então as outras divergem dela e rodam pelo caminho escalar.
+	static const uint16_t program[] = { 0x3000, 0x2208, 0x7001, 0x1200, 0x00EE };
+	for (size_t j=0; j<sizeof(program)/sizeof(program[0]); j++) {
+		emu._memory[0x200 + 2*j] = program[j] >> 8;
+		emu._memory[0x200 + 2*j + 1] = program[j] & 0xFF;
+	}
+	emu._profile = profile_create();
+	TEST_ASSERT_NOT_NULL(emu._profile);
+
+	TEST_ASSERT_EQUAL_INT(0, emulator_batch_init(&batch, &emu, 3));
+	batch.v[0][1] = 1;
+	emulator_batch_step(&batch, 50);
+
+	for (size_t k=0; k<batch.count; k++) {
+		TEST_ASSERT_NULL(batch.instances[k]._profile);
+	}
+	TEST_ASSERT_EQUAL_UINT64(0, profile_count(emu._profile, 0x200));
+	TEST_ASSERT_EQUAL_UINT64(0, profile_count(emu._profile, 0x202));
+
+	emulator_batch_free(&batch);
+	profile_destroy(emu._profile);
+	emu._profile = NULL;
+}
+#endif
+
+void test_snapshot_restore_replays_identically(void) {
+	static struct emulator_snapshot start, first, second;
+
+	// 0x200: 6200 (LD V2, kk); 8124 (ADD V1, V2); C0FF (RND V0, 0xFF); A201 (LD I, 0x201);
+	//        F055 (reescreve o kk do primeiro LD); D015 (DRW V0, V1, 5); 1200 (JP 0x200)
+	static const uint8_t program[] = {
+		0x62, 0x00, 0x81, 0x24, 0xC0, 0xFF, 0xA2, 0x01, 0xF0, 0x55, 0xD0, 0x15, 0x12, 0x00,
+	};
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+
+	emulator_snapshot(&emu, &start);
+	for (int frame=0; frame<9; frame++) {
+		emulator_tick(&emu);
+	}
+	emulator_snapshot(&emu, &first);
+
+	// 9 quadros de 16 ciclos param logo depois do LD, então o cache (e o JIT) ficam com o kk
+	// reescrito; voltar tem que descartar isso
+	TEST_ASSERT_EQUAL_INT(0, emulator_restore(&emu, &start));
+	TEST_ASSERT_EQUAL_HEX8(0x00, emu._memory[0x201]);
+	for (int frame=0; frame<9; frame++) {
+		emulator_tick(&emu);
+	}
+	emulator_snapshot(&emu, &second);
+
+	TEST_ASSERT_EQUAL_MEMORY(&first, &second, sizeof(struct emulator_snapshot));
+
+	// O padding não carrega o que já estava no buffer
+	memset(&first, 0xAA, sizeof(first));
+	memset(&second, 0x55, sizeof(second));
+	emulator_snapshot(&emu, &first);
+	emulator_snapshot(&emu, &second);
+	TEST_ASSERT_EQUAL_MEMORY(&first, &second, sizeof(struct emulator_snapshot));
+
+	// Snapshot de outra versão não é aplicado
+	start.version = EMULATOR_SNAPSHOT_VERSION + 1;
+	TEST_ASSERT_EQUAL_INT(1, emulator_restore(&emu, &start));
+	TEST_ASSERT_EQUAL_UINT16(second.pc, emu._pc);
+}
+
+void test_clone_runs_identically(void) {
+	static struct emulator clone;
+	static struct emulator_snapshot original, copy;
+
+	// C0FF (RND V0, 0xFF); A300 (LD I, 0x300); F033 (LD B, V0); 1200 (JP 0x200)
+	static const uint8_t program[] = { 0xC0, 0xFF, 0xA3, 0x00, 0xF0, 0x33, 0x12, 0x00 };
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+	emulator_tick(&emu);
+
+	// O destino tinha falhado antes; a falha antiga não sobrevive à cópia
+	memset(&clone, 0, sizeof(clone));
+	clone.fault.kind = EMULATOR_FAULT_STACK_UNDERFLOW;
+	clone.fault.pc = 0x204;
+	emulator_clone(&clone, &emu);
+	TEST_ASSERT_EQUAL_UINT8(EMULATOR_FAULT_NONE, clone.fault.kind);
+	TEST_ASSERT_EQUAL_UINT16(emu.fault.pc, clone.fault.pc);
+	for (int frame=0; frame<5; frame++) {
+		emulator_tick(&emu);
+		emulator_tick(&clone);
+	}
+
+	emulator_snapshot(&emu, &original);
+	emulator_snapshot(&clone, &copy);
+	TEST_ASSERT_EQUAL_MEMORY(&original, &copy, sizeof(struct emulator_snapshot));
+	emulator_quit(&clone);
+}
+
+void test_hashes_track_state(void) {
+	static struct emulator other;
+	other = emu;
+
+	TEST_ASSERT_EQUAL_HEX64(emulator_screen_hash(&emu), emulator_screen_hash(&other));
+	TEST_ASSERT_EQUAL_HEX64(emulator_state_hash(&emu), emulator_state_hash(&other));
+
+	// Um registrador muda só o estado
+	other._v[5] = 1;
+	TEST_ASSERT_EQUAL_HEX64(emulator_screen_hash(&emu), emulator_screen_hash(&other));
+	TEST_ASSERT_NOT_EQUAL(emulator_state_hash(&emu), emulator_state_hash(&other));
+
+	// Um pixel muda os dois
+	other._v[5] = 0;
+	other.screen[31][0] = 1;
+	TEST_ASSERT_NOT_EQUAL(emulator_screen_hash(&emu), emulator_screen_hash(&other));
+	TEST_ASSERT_NOT_EQUAL(emulator_state_hash(&emu), emulator_state_hash(&other));
+}
+
+void test_load_rom_from_buffer_and_file(void) {
+	// LD V1, 0x11; CALL 0x206
+	static const uint8_t program[] = { 0x61, 0x11, 0x22, 0x06 };
+	static struct emulator loaded;
+
+	TEST_ASSERT_EQUAL_INT(EMULATOR_OK, emulator_init_from_buffer(&loaded, program, sizeof(program), 3));
+	TEST_ASSERT_EQUAL_INT(EMULATOR_OK, emulator_reset(&emu, program, sizeof(program), 3));
+	TEST_ASSERT_EQUAL_HEX64(emulator_state_hash(&emu), emulator_state_hash(&loaded));
+
+	// Uma ROM grande demais não mexe no emulador
+	static uint8_t big[MEMORY_SIZE - MEMORY_START + 1];
+	TEST_ASSERT_EQUAL_INT(EMULATOR_ERROR_TOO_BIG, emulator_init_from_buffer(&loaded, big, sizeof(big), 0));
+	TEST_ASSERT_EQUAL_HEX64(emulator_state_hash(&emu), emulator_state_hash(&loaded));
+	emulator_quit(&loaded);
+
+	// Pelo arquivo mapeado, o mesmo estado
+	char path[] = "/tmp/c8emu-test-XXXXXX";
+	const int fd = mkstemp(path);
+	TEST_ASSERT_TRUE(fd >= 0);
+	TEST_ASSERT_EQUAL_INT(sizeof(program), write(fd, program, sizeof(program)));
+	close(fd);
+
+	struct emulator_rom rom;
+	TEST_ASSERT_EQUAL_INT(EMULATOR_OK, emulator_rom_map(&rom, path));
+	TEST_ASSERT_EQUAL_size_t(sizeof(program), rom.size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(program, rom.data, sizeof(program));
+	emulator_rom_unmap(&rom);
+
+	TEST_ASSERT_EQUAL_INT(EMULATOR_OK, emulator_init(&loaded, path, 3));
+	TEST_ASSERT_EQUAL_HEX64(emulator_state_hash(&emu), emulator_state_hash(&loaded));
+	emulator_quit(&loaded);
+	unlink(path);
+
+	TEST_ASSERT_EQUAL_INT(EMULATOR_ERROR_OPEN, emulator_init(&loaded, path, 3));
+	TEST_ASSERT_EQUAL_INT(EMULATOR_ERROR_OPEN, emulator_rom_map(&rom, path));
+}
+
+void test_library_isolates_faults(void) {
+	// LD V0, 1; 0xE1FF (desconhecido)
+	static const uint8_t bad[] = { 0x60, 0x01, 0xE1, 0xFF };
+	// ADD V0, 1; JP 0x200
+	static const uint8_t good[] = { 0x70, 0x01, 0x12, 0x00 };
+	c8emu* a;
+	c8emu* b;
+
+	TEST_ASSERT_EQUAL_INT(C8EMU_OK, c8emu_create(&a, bad, sizeof(bad), 0));
+	TEST_ASSERT_EQUAL_INT(C8EMU_OK, c8emu_create(&b, good, sizeof(good), 0));
+
+	TEST_ASSERT_EQUAL_INT(C8EMU_ERROR_FAULT, c8emu_run_frame(a, 0));
+	struct c8emu_fault fault;
+	TEST_ASSERT_EQUAL_INT(1, c8emu_fault(a, &fault));
+	TEST_ASSERT_EQUAL_INT(C8EMU_FAULT_UNKNOWN_OPCODE, fault.kind);
+	TEST_ASSERT_EQUAL_HEX16(0x202, fault.pc);
+	TEST_ASSERT_EQUAL_HEX16(0xE1FF, fault.opcode);
+	TEST_ASSERT_EQUAL_UINT64(0, fault.frame);
+	// A falha fica até o reset
+	TEST_ASSERT_EQUAL_INT(C8EMU_ERROR_FAULT, c8emu_run_frame(a, 0));
+
+	// A outra instância nem percebe
+	uint8_t* snapshot = malloc(c8emu_snapshot_size());
+	TEST_ASSERT_NOT_NULL(snapshot);
+	for (int frame=0; frame<3; frame++) {
+		TEST_ASSERT_EQUAL_INT(C8EMU_OK, c8emu_run_frame(b, 0));
+	}
+	TEST_ASSERT_EQUAL_INT(0, c8emu_fault(b, &fault));
+	c8emu_snapshot(b, snapshot);
+	TEST_ASSERT_EQUAL_INT(C8EMU_OK, c8emu_run_frame(b, 0));
+	const uint64_t hash = c8emu_state_hash(b);
+	TEST_ASSERT_EQUAL_INT(C8EMU_OK, c8emu_restore(b, snapshot, c8emu_snapshot_size()));
+	TEST_ASSERT_EQUAL_UINT64(3, c8emu_frame(b));
+	TEST_ASSERT_EQUAL_INT(C8EMU_OK, c8emu_run_frame(b, 0));
+	TEST_ASSERT_EQUAL_HEX64(hash, c8emu_state_hash(b));
+	TEST_ASSERT_EQUAL_INT(C8EMU_ERROR_SNAPSHOT, c8emu_restore(b, snapshot, c8emu_snapshot_size() - 1));
+	free(snapshot);
+
+	TEST_ASSERT_EQUAL_INT(C8EMU_OK, c8emu_reset(a, good, sizeof(good), 0));
+	TEST_ASSERT_EQUAL_INT(C8EMU_OK, c8emu_run_frame(a, 0));
+
+	c8emu_destroy(a);
+	c8emu_destroy(b);
+
+	static uint8_t big[MEMORY_SIZE - MEMORY_START + 1];
+	TEST_ASSERT_EQUAL_INT(C8EMU_ERROR_TOO_BIG, c8emu_create(&a, big, sizeof(big), 0));
+	TEST_ASSERT_NULL(a);
+}
+
+void test_pacer_keeps_exact_rate(void) {
+	struct pacer pacer;
+	pacer_init(&pacer, 1000, 1000, PACER_CATCH_UP);
+
+	// Acordando em intervalos irregulares, um segundo ainda dá 60 quadros e 1000 instruções
+	unsigned frames = 0;
+	size_t cycles = 0;
+	for (uint64_t step=1; step<=97; step++) {
+		const uint64_t now = 1000 + step * step * PACER_NS_PER_SECOND / (97 * 97);
+		for (unsigned f=pacer_advance(&pacer, now); f>0; f--) {
+			frames++;
+			cycles += pacer_next_frame(&pacer).cycles;
+		}
+	}
+	TEST_ASSERT_EQUAL_UINT(60, frames);
+	TEST_ASSERT_EQUAL_UINT(1000, cycles);
+	TEST_ASSERT_EQUAL_UINT64(16666667, pacer_wait(&pacer, 1000 + PACER_NS_PER_SECOND));
+
+	// Meio segundo parado: só PACER_MAX_CATCH_UP quadros rodam, o resto é descartado
+	TEST_ASSERT_EQUAL_UINT(PACER_MAX_CATCH_UP, pacer_advance(&pacer, 1000 + PACER_NS_PER_SECOND * 3 / 2));
+	TEST_ASSERT_EQUAL_UINT64(30 - PACER_MAX_CATCH_UP, pacer.dropped);
+
+	// O quadro que roda é o mais recente: o intervalo dele começa depois dos descartados
+	pacer_init(&pacer, 0, 960, PACER_DROP);
+	TEST_ASSERT_EQUAL_UINT(1, pacer_advance(&pacer, PACER_NS_PER_SECOND / 10));
+	TEST_ASSERT_EQUAL_UINT64(5, pacer.dropped);
+	const struct pacer_frame frame = pacer_next_frame(&pacer);
+	TEST_ASSERT_EQUAL_UINT64(83333333, frame.start);
+	TEST_ASSERT_EQUAL_UINT64(PACER_NS_PER_SECOND / 10, frame.end);
+	TEST_ASSERT_EQUAL_size_t(16, frame.cycles);
+}
+
+void test_movie_replays_recorded_keys(void) {
+	// 0x200: LD V0, 5; SKP V0; ADD V1, 1; RND V2, 0xFF; JP 0x202
+	static const uint8_t program[] = { 0x60, 0x05, 0xE0, 0x9E, 0x71, 0x01, 0xC2, 0xFF, 0x12, 0x02 };
+	struct movie movie;
+	FILE* file = tmpfile();
+	TEST_ASSERT_NOT_NULL(file);
+
+	TEST_ASSERT_EQUAL_INT(0, emulator_reset(&emu, program, sizeof(program), 7));
+	emu.cycles_per_frame = 8;
+	TEST_ASSERT_EQUAL_INT(0, movie_record(&movie, file, &emu, 7));
+	for (int frame=0; frame<100; frame++) {
+		const uint16_t keys = (frame / 30) % 2 ? 1 << 5 : 0;
+		TEST_ASSERT_EQUAL_INT(0, movie_record_frame(&movie, keys));
+		emu.keys = keys;
+		emulator_tick(&emu);
+	}
+	const uint64_t final_hash = emulator_state_hash(&emu);
+	TEST_ASSERT_EQUAL_INT(0, movie_finish(&movie, &emu));
+
+	// Cabeçalho (29 bytes), 4 sequências de 3 bytes e o fim (17 bytes)
+	TEST_ASSERT_EQUAL_INT(29 + 4*3 + 17, ftell(file));
+
+	rewind(file);
+	TEST_ASSERT_EQUAL_INT(0, movie_open(&movie, file));
+	TEST_ASSERT_EQUAL_UINT64(7, movie.seed);
+	TEST_ASSERT_EQUAL_UINT8(8, movie.cycles_per_frame);
+
+	TEST_ASSERT_EQUAL_INT(0, emulator_reset(&emu, program, sizeof(program), movie.seed));
+	emu.cycles_per_frame = movie.cycles_per_frame;
+	TEST_ASSERT_EQUAL_HEX64(movie.start_hash, emulator_state_hash(&emu));
+
+	uint16_t keys;
+	while (movie_next(&movie, &keys) == 0) {
+		TEST_ASSERT_EQUAL_HEX16((movie.frame - 1) / 30 % 2 ? 1 << 5 : 0, keys);
+		emu.keys = keys;
+		emulator_tick(&emu);
+	}
+	TEST_ASSERT_TRUE(movie.ended);
+	TEST_ASSERT_EQUAL_UINT64(100, movie.frames);
+	TEST_ASSERT_EQUAL_HEX64(movie.final_hash, final_hash);
+	TEST_ASSERT_EQUAL_HEX64(final_hash, emulator_state_hash(&emu));
+
+	fclose(file);
+}
+
+#ifdef EMULATOR_STATS
+void test_stats_count_each_class(void) {
+	// 6005 (LD V0, 5); 7001 (ADD V0, 1); 3009 (SE V0, 9); 1202 (JP 0x202); 1208 (JP 0x208)
+	static const uint8_t program[] = { 0x60, 0x05, 0x70, 0x01, 0x30, 0x09, 0x12, 0x02, 0x12, 0x08 };
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+
+	for (int c=0; c<1 + 4*3 + 3; c++) {
+		emulator_cycle(&emu);
+	}
+
+	TEST_ASSERT_EQUAL_UINT64(1, emu._op_count[EMULATOR_OP_LD_KK]);
+	TEST_ASSERT_EQUAL_UINT64(4, emu._op_count[EMULATOR_OP_ADD_KK]);
+	TEST_ASSERT_EQUAL_UINT64(4, emu._op_count[EMULATOR_OP_SE_KK]);
+	TEST_ASSERT_EQUAL_UINT64(3, emu._op_count[EMULATOR_OP_JP]);
+	TEST_ASSERT_EQUAL_UINT64(4, emu._op_count[EMULATOR_OP_JP_SELF]);
+}
+#endif
+
+#ifdef EMULATOR_PROFILE
+void test_profile_follows_calls(void) {
+	// 0x200: CALL 0x206; CALL 0x206; JP 0x204 (pra si mesmo)
+	// 0x206: CALL 0x20C; RET
+	// 0x20C: LD V0, 1; RET
+	static const uint8_t program[] = {
+		0x22, 0x06, 0x22, 0x06, 0x12, 0x04, 0x22, 0x0C, 0x00, 0xEE, 0x00, 0x00, 0x60, 0x01, 0x00, 0xEE,
+	};
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+
+	emu._profile = profile_create();
+	TEST_ASSERT_NOT_NULL(emu._profile);
+
+	emulator_tick(&emu);
+
+	// 11 instruções até o JP; os 5 ciclos que sobram do quadro ficam no laço ocioso
+	TEST_ASSERT_EQUAL_UINT64(1, profile_count(emu._profile, 0x200));
+	TEST_ASSERT_EQUAL_UINT64(2, profile_count(emu._profile, 0x206));
+	TEST_ASSERT_EQUAL_UINT64(2, profile_count(emu._profile, 0x20E));
+	TEST_ASSERT_EQUAL_UINT64(6, profile_count(emu._profile, 0x204));
+
+	FILE* folded = tmpfile();
+	TEST_ASSERT_NOT_NULL(folded);
+	TEST_ASSERT_EQUAL_INT(0, profile_write_folded(emu._profile, folded));
+
+	char text[128] = { 0 };
+	rewind(folded);
+	TEST_ASSERT_TRUE(fread(text, 1, sizeof(text)-1, folded) > 0);
+	fclose(folded);
+	TEST_ASSERT_EQUAL_STRING("rom 8\nrom;0x206 4\nrom;0x206;0x20C 4\n", text);
+
+	profile_destroy(emu._profile);
+	emu._profile = NULL;
+}
+#endif
+
+#ifdef EMULATOR_TRACE
+// Lê o trace gravado em file e compara com expected
+static void check_trace(FILE* file, const struct trace_record* expected, size_t length) {
+	struct trace_record records[16];
+
+	rewind(file);
+	TEST_ASSERT_EQUAL_INT(0, trace_read_header(file));
+	const size_t count = fread(records, sizeof(struct trace_record), 16, file);
+	fclose(file);
+
+	TEST_ASSERT_EQUAL_size_t(length, count);
+	for (size_t j=0; j<count; j++) {
+		TEST_ASSERT_EQUAL_HEX16(expected[j].pc, records[j].pc);
+		TEST_ASSERT_EQUAL_HEX16(expected[j].opcode, records[j].opcode);
+		TEST_ASSERT_EQUAL_HEX8(expected[j].kind, records[j].kind);
+		TEST_ASSERT_EQUAL_HEX8(expected[j].index, records[j].index);
+		TEST_ASSERT_EQUAL_HEX16(expected[j].value, records[j].value);
+	}
+}
+
+void test_trace_records_changes(void) {
+	// LD V1, 5; LD V2, FF; ADD V1, V2; LD I, 0x300; LD [I], V1; JP 0x20A (pra si mesmo)
+	static const uint8_t program[] = {
+		0x61, 0x05, 0x62, 0xFF, 0x81, 0x24, 0xA3, 0x00, 0xF1, 0x55, 0x12, 0x0A,
+	};
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+	emu._delay_timer = 3;
+	emu.keys = 0x0010;
+
+	FILE* file = tmpfile();
+	TEST_ASSERT_NOT_NULL(file);
+	emu._trace = trace_create(file);
+	TEST_ASSERT_NOT_NULL(emu._trace);
+
+	emulator_tick(&emu);
+
+	TEST_ASSERT_EQUAL_INT(0, trace_destroy(emu._trace));
+	emu._trace = NULL;
+
+	const struct trace_record expected[] = {
+		{ 0x200, 0x6105, TRACE_V, 1, 5 },
+		{ 0x202, 0x62FF, TRACE_V, 2, 0xFF },
+		{ 0x204, 0x8124, TRACE_V, 1, 4 },
+		{ 0x204, 0x8124, TRACE_V | TRACE_CONTINUE, 0xF, 1 },
+		{ 0x206, 0xA300, TRACE_I, 0, 0x300 },
+		{ 0x208, 0xF155, TRACE_MEM, 0, 0x300 },
+		{ 0x208, 0xF155, TRACE_MEM | TRACE_CONTINUE, 4, 0x301 },
+		{ 0x20A, 0x120A, TRACE_EXEC, 0, 0 },
+		// O quadro tem 16 ciclos e 6 foram executados
+		{ 0x20A, 0x120A, TRACE_IDLE | TRACE_CONTINUE, 0, 10 },
+		{ 0x20A, 0, TRACE_FRAME, 2, 0x0010 },
+	};
+	check_trace(file, expected, sizeof(expected)/sizeof(expected[0]));
+}
+
+void test_trace_records_stack_and_rpl(void) {
+	// 0x200: LD V1, 7; LD R, V1; CALL 0x20A; 0x206: JP 0x206 (pra si mesmo); 0x20A: RET
+	static const uint8_t program[] = {
+		0x61, 0x07, 0xF1, 0x75, 0x22, 0x0A, 0x12, 0x06, 0x00, 0x00, 0x00, 0xEE,
+	};
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+
+	FILE* file = tmpfile();
+	TEST_ASSERT_NOT_NULL(file);
+	emu._trace = trace_create(file);
+	TEST_ASSERT_NOT_NULL(emu._trace);
+
+	emulator_tick(&emu);
+
+	TEST_ASSERT_EQUAL_INT(0, trace_destroy(emu._trace));
+	emu._trace = NULL;
+
+	const struct trace_record expected[] = {
+		{ 0x200, 0x6107, TRACE_V, 1, 7 },
+		{ 0x202, 0xF175, TRACE_RPL, 0, 0 },
+		{ 0x202, 0xF175, TRACE_RPL | TRACE_CONTINUE, 1, 7 },
+		{ 0x204, 0x220A, TRACE_STACK, 1, 0x206 },
+		{ 0x20A, 0x00EE, TRACE_STACK, 0, 0x206 },
+		{ 0x206, 0x1206, TRACE_EXEC, 0, 0 },
+		{ 0x206, 0x1206, TRACE_IDLE | TRACE_CONTINUE, 0, 11 },
+		{ 0x206, 0, TRACE_FRAME, 0, 0 },
+	};
+	check_trace(file, expected, sizeof(expected)/sizeof(expected[0]));
+}
+#endif
+
+#ifdef EMULATOR_JIT
+static struct emulator reference;
+
+// Roda o mesmo programa com e sem JIT e compara o estado a cada quadro
+static void compare_with_interpreter(const uint16_t* program, size_t length, uint8_t cycles_per_frame, size_t ticks) {
+	for (size_t k=0; k<length; k++) {
+		emu._memory[0x200 + 2*k] = program[k] >> 8;
+		emu._memory[0x200 + 2*k + 1] = program[k] & 0xFF;
+	}
+	emu.cycles_per_frame = cycles_per_frame;
+	reference = emu;
+	emu._jit = jit_create();
+	TEST_ASSERT_NOT_NULL(emu._jit);
+
+	for (size_t t=0; t<ticks; t++) {
+		emulator_tick(&emu);
+		emulator_tick(&reference);
+
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(reference._v, emu._v, 16);
+		TEST_ASSERT_EQUAL_UINT16(reference._i, emu._i);
+		TEST_ASSERT_EQUAL_UINT16(reference._pc, emu._pc);
+		TEST_ASSERT_EQUAL_UINT8(reference._delay_timer, emu._delay_timer);
+		TEST_ASSERT_EQUAL_UINT8(reference._sound_timer, emu._sound_timer);
+	}
+}
+
+void test_jit_matches_interpreter(void) {
+	// Cada flag vai pra um registrador próprio, senão um VF errado some na instrução seguinte
+	static const uint16_t program[] = {
+		0xF807, // V8 = DT do quadro anterior
+		0x60FE, 0x6103, 0x8014, 0x8EF0, // ADD com carry
+		0x6210, 0x8215, 0x8DF0, // SUB
+		0x6305, 0x8327, 0x8CF0, // SUBN
+		0x6481, 0x840E, 0x8BF0, // SHL
+		0x6503, 0x8506, 0x8AF0, // SHR
+		0x8F24, 0x8F06, 0x6F80, 0x8FFE, 0x89F0, // VF como destino e como origem
+		0x6710, 0x6F03, 0x87F5,
+		0xA123, 0xF21E, // I
+		0x6633, 0xF615, 0xF618, // Timers
+		0x8D31, 0x8C42, 0x8B53, 0x8B90,
+		0x3E01, 0x6E55, // Pulos: tomado, não tomado, com registradores
+		0x4E01, 0x7D10,
+		0x5EA0, 0x6E77,
+		0x9EA0, 0x7C01,
+		0xB1FF, // Volta pro início (0x1FF + V0 = 0x200)
+	};
+	compare_with_interpreter(program, sizeof(program)/sizeof(program[0]), 255, 8);
+}
+
+void test_jit_block_longer_than_frame(void) {
+	// O bloco (20 instruções) não cabe nos 7 ciclos do quadro
+	static const uint16_t program[] = {
+		0x7001, 0x7102, 0x7203, 0x7304, 0x7405, 0x7506, 0x7607, 0x7708, 0x7809, 0x790A,
+		0x7A0B, 0x7B0C, 0x7C0D, 0x7D0E, 0x7E0F, 0x8014, 0x8125, 0x8237, 0x834E, 0x1200,
+	};
+	compare_with_interpreter(program, sizeof(program)/sizeof(program[0]), 7, 50);
+}
+
+void test_jit_invalidates_modified_block(void) {
+	emu._jit = jit_create();
+	TEST_ASSERT_NOT_NULL(emu._jit);
+
+	// 0x200: 6105 (LD V1, 0x05); 0x202: 1200 (JP 0x200)
+	load_opcode(0x6105);
+	emu._pc = 0x202;
+	load_opcode(0x1200);
+	emu._pc = 0x200;
+	emulator_tick(&emu);
+	TEST_ASSERT_EQUAL_UINT8(0x05, emu._v[1]);
+
+	// F155 em 0x300 reescreve 0x200 com 6107
+	emu._pc = 0x300;
+	emu._i = 0x200;
+	emu._v[0] = 0x61;
+	emu._v[1] = 0x07;
+	load_opcode(0xF155);
+	emulator_cycle(&emu);
+
+	emu._pc = 0x200;
+	emu._v[1] = 0;
+	emulator_tick(&emu);
+	TEST_ASSERT_EQUAL_UINT8(0x07, emu._v[1]);
+}
+
+void test_jit_arena_is_never_writable_and_executable(void) {
+	emu._jit = jit_create();
+	TEST_ASSERT_NOT_NULL(emu._jit);
+
+	// 7001 (ADD V0, 1); 1200 (JP 0x200): um bloco compilado e rodando
+	static const uint8_t program[] = { 0x70, 0x01, 0x12, 0x00 };
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+	emulator_tick(&emu);
+	TEST_ASSERT_NOT_EQUAL(0, emu._v[0]);
+
+	// Nenhuma região do processo fica rwx
+	FILE* maps = fopen("/proc/self/maps", "r");
+	TEST_ASSERT_NOT_NULL(maps);
+	char line[512];
+	while (fgets(line, sizeof(line), maps) != NULL) {
+		char perms[5] = "";
+		TEST_ASSERT_EQUAL_INT(1, sscanf(line, "%*s %4s", perms));
+		TEST_ASSERT_FALSE(strncmp(perms, "rwx", 3) == 0);
+	}
+	fclose(maps);
+}
+
+void test_jit_fast_forwards_idle_loop(void) {
+	emu._jit = jit_create();
+	TEST_ASSERT_NOT_NULL(emu._jit);
+
+	// 6005 (LD V0, 5); 1202 (JP 0x202)
+	static const uint8_t program[] = { 0x60, 0x05, 0x12, 0x02 };
+	memcpy(emu._memory + 0x200, program, sizeof(program));
+	emu.cycles_per_frame = 255;
+
+	for (int frame=0; frame<100; frame++) {
+		TEST_ASSERT_EQUAL_INT(0, emulator_tick(&emu));
+	}
+	TEST_ASSERT_EQUAL_UINT16(0x202, emu._pc);
+	TEST_ASSERT_EQUAL_UINT8(5, emu._v[0]);
+
+#ifdef EMULATOR_STATS
+	// Um JP por quadro: o resto do quadro é adiantado, não executado um ciclo por vez
+	TEST_ASSERT_EQUAL_UINT64(100, emu._op_count[EMULATOR_OP_JP_SELF]);
+#endif
+}
+#endif
+
 int main(void) {
 	UNITY_BEGIN();
 	RUN_TEST(test_opcode_6xkk_sets_register);
@@ -400,6 +1412,10 @@ int main(void) {
 	RUN_TEST(test_opcode_8xy4_adds_no_carry);
 	RUN_TEST(test_opcode_2nnn_and_00EE_call_return);
 	RUN_TEST(test_opcode_dxyn_draw_sets_collision);
+	RUN_TEST(test_opcode_dxyn_draw_wraps_around);
+	RUN_TEST(test_schip_hires_sprite_clips_and_counts_rows);
+	RUN_TEST(test_schip_hires_sprite_counts_rows_clipped_at_bottom);
+	RUN_TEST(test_schip_scroll_and_rpl_flags);
 	RUN_TEST(test_stack_overflow_protection);
 	RUN_TEST(test_stack_underflow_protection);
 	RUN_TEST(test_pc_out_of_bounds_protection);
@@ -421,6 +1437,42 @@ int main(void) {
 	RUN_TEST(test_opcode_Fx0A_halts_until_keypress);
 	RUN_TEST(test_opcode_Fx29_font_character_pointer);
 	RUN_TEST(test_chained_skips);
+	RUN_TEST(test_opcode_Cxkk_is_deterministic_per_seed);
+	RUN_TEST(test_fx55_invalidates_decoded_instruction);
+	RUN_TEST(test_fx33_invalidates_decoded_instruction);
+	RUN_TEST(test_odd_pc_executes);
+	RUN_TEST(test_idle_loops_match_stepping);
+	RUN_TEST(test_run_in_pieces_matches_tick);
+	RUN_TEST(test_reset_loads_new_rom_in_place);
+	RUN_TEST(test_batch_matches_single_instances);
+	RUN_TEST(test_batch_keeps_vectors_after_a_fault);
+#ifdef EMULATOR_PROFILE
+	RUN_TEST(test_batch_lanes_leave_the_prototype_profile_alone);
+#endif
+	RUN_TEST(test_snapshot_restore_replays_identically);
+	RUN_TEST(test_clone_runs_identically);
+	RUN_TEST(test_hashes_track_state);
+	RUN_TEST(test_load_rom_from_buffer_and_file);
+	RUN_TEST(test_library_isolates_faults);
+	RUN_TEST(test_pacer_keeps_exact_rate);
+	RUN_TEST(test_movie_replays_recorded_keys);
+#ifdef EMULATOR_STATS
+	RUN_TEST(test_stats_count_each_class);
+#endif
+#ifdef EMULATOR_PROFILE
+	RUN_TEST(test_profile_follows_calls);
+#endif
+#ifdef EMULATOR_TRACE
+	RUN_TEST(test_trace_records_changes);
+	RUN_TEST(test_trace_records_stack_and_rpl);
+#endif
+#ifdef EMULATOR_JIT
+	RUN_TEST(test_jit_matches_interpreter);
+	RUN_TEST(test_jit_block_longer_than_frame);
+	RUN_TEST(test_jit_invalidates_modified_block);
+	RUN_TEST(test_jit_arena_is_never_writable_and_executable);
+	RUN_TEST(test_jit_fast_forwards_idle_loop);
+#endif
 
 	return UNITY_END();
 }
\ No newline at end of file
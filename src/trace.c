@@ -0,0 +1,262 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+// nanosleep e pthreads
+#define _POSIX_C_SOURCE 200112L
+
+#include "trace.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Registros no buffer (potência de 2): 1 MiB
+#define RING_SIZE (1 << 17)
+#define RING_MASK (RING_SIZE - 1)
+
+// Quanto a thread de escrita dorme quando não tem nada pra gravar
+#define WRITER_SLEEP_NS 1000000
+
+// head e tail ficam em linhas de cache separadas, pra escrita de um lado não invalidar o outro
+#define CACHE_LINE 64
+
+struct trace {
+	struct trace_record ring[RING_SIZE];
+
+	// Só o emulador escreve. Os registros até head já podem ser lidos.
+	size_t head;
+	// Último tail visto pelo emulador: só relê o de verdade quando o buffer parece cheio
+	size_t cached_tail;
+	char _pad_head[CACHE_LINE];
+
+	// Só a thread de escrita escreve. Os registros até tail já foram gravados.
+	size_t tail;
+	char _pad_tail[CACHE_LINE];
+
+	bool stop;
+	bool failed;
+
+	FILE* out;
+	pthread_t writer;
+};
+
+static void pause_writer(void) {
+	const struct timespec ts = { 0, WRITER_SLEEP_NS };
+	nanosleep(&ts, NULL);
+}
+
+// Grava de tail até head em escritas contíguas (uma ou duas, se der a volta no buffer)
+static void* writer(void* arg) {
+	struct trace* trace = arg;
+
+	for (;;) {
+		// Lido antes do head: se já era pra parar, o head visto depois está completo
+		const bool stop = __atomic_load_n(&trace->stop, __ATOMIC_ACQUIRE);
+		const size_t head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+		size_t tail = trace->tail;
+
+		if (head == tail) {
+			if (stop) {
+				break;
+			}
+			pause_writer();
+			continue;
+		}
+
+		while (tail != head) {
+			const size_t start = tail & RING_MASK;
+			size_t count = head - tail;
+			if (count > RING_SIZE - start) {
+				count = RING_SIZE - start;
+			}
+
+			if (!trace->failed && fwrite(&trace->ring[start], sizeof(struct trace_record), count, trace->out) != count) {
+				// Continua esvaziando, senão o emulador trava esperando espaço
+				trace->failed = true;
+			}
+			tail += count;
+		}
+
+		__atomic_store_n(&trace->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+struct trace* trace_create(FILE* out) {
+	struct trace_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(struct trace_record);
+
+	if (fwrite(&header, sizeof(header), 1, out) != 1) {
+		return NULL;
+	}
+
+	struct trace* trace = calloc(1, sizeof(struct trace));
+	if (trace == NULL) {
+		return NULL;
+	}
+	trace->out = out;
+
+	if (pthread_create(&trace->writer, NULL, writer, trace) != 0) {
+		free(trace);
+		return NULL;
+	}
+
+	return trace;
+}
+
+int trace_destroy(struct trace* trace) {
+	__atomic_store_n(&trace->stop, true, __ATOMIC_RELEASE);
+	pthread_join(trace->writer, NULL);
+
+	const int result = trace->failed || fflush(trace->out) != 0 ? 1 : 0;
+	free(trace);
+	return result;
+}
+
+void trace_flush(struct trace* trace) {
+	while (__atomic_load_n(&trace->tail, __ATOMIC_ACQUIRE) != trace->head) {
+		sched_yield();
+	}
+	fflush(trace->out);
+}
+
+static inline void push(struct trace* trace, uint16_t pc, uint16_t opcode, uint8_t kind, uint8_t index, uint16_t value) {
+	const size_t head = trace->head;
+
+	// Cheio: espera a thread de escrita. O trace não perde registros.
+	if (head - trace->cached_tail == RING_SIZE) {
+		while ((trace->cached_tail = __atomic_load_n(&trace->tail, __ATOMIC_ACQUIRE)) == head - RING_SIZE) {
+			sched_yield();
+		}
+	}
+
+	struct trace_record* record = &trace->ring[head & RING_MASK];
+	record->pc = pc;
+	record->opcode = opcode;
+	record->kind = kind;
+	record->index = index;
+	record->value = value;
+
+	__atomic_store_n(&trace->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void trace_step(struct trace* trace, const struct emulator* emulator, uint16_t pc, uint16_t opcode,
+	const struct emulator_decoded* d, size_t idle) {
+	const uint8_t x = d->x;
+
+	switch (d->op) {
+	case EMULATOR_OP_LD_KK:
+	case EMULATOR_OP_ADD_KK:
+	case EMULATOR_OP_LD_VY:
+	case EMULATOR_OP_OR:
+	case EMULATOR_OP_AND:
+	case EMULATOR_OP_XOR:
+	case EMULATOR_OP_RND:
+	case EMULATOR_OP_LD_VX_DT:
+	case EMULATOR_OP_WAIT_DT_SE:
+	case EMULATOR_OP_WAIT_DT_SNE:
+	case EMULATOR_OP_LD_K:
+		push(trace, pc, opcode, TRACE_V, x, emulator->_v[x]);
+		break;
+	// Mudam Vx e VF (que pode ser o próprio Vx)
+	case EMULATOR_OP_ADD_VY:
+	case EMULATOR_OP_SUB:
+	case EMULATOR_OP_SHR:
+	case EMULATOR_OP_SUBN:
+	case EMULATOR_OP_SHL:
+		push(trace, pc, opcode, TRACE_V, x, emulator->_v[x]);
+		if (x != 0xF) {
+			push(trace, pc, opcode, TRACE_V | TRACE_CONTINUE, 0xF, emulator->_v[0xF]);
+		}
+		break;
+	// A tela sai do que está na memória; só a colisão precisa ficar no trace
+	case EMULATOR_OP_DRW:
+		push(trace, pc, opcode, TRACE_V, 0xF, emulator->_v[0xF]);
+		break;
+	case EMULATOR_OP_LD_I:
+	case EMULATOR_OP_ADD_I:
+	case EMULATOR_OP_LD_F:
+	case EMULATOR_OP_LD_HF:
+		push(trace, pc, opcode, TRACE_I, 0, emulator->_i);
+		break;
+	case EMULATOR_OP_CALL:
+		push(trace, pc, opcode, TRACE_STACK, emulator->_sp, emulator->_stack[emulator->_sp - 1]);
+		break;
+	// O endereço desempilhado continua na posição que ficou livre
+	case EMULATOR_OP_RET:
+		push(trace, pc, opcode, TRACE_STACK, emulator->_sp, emulator->_stack[emulator->_sp]);
+		break;
+	case EMULATOR_OP_LD_DT:
+		push(trace, pc, opcode, TRACE_TIMER, 0, emulator->_delay_timer);
+		break;
+	case EMULATOR_OP_LD_ST:
+		push(trace, pc, opcode, TRACE_TIMER, 1, emulator->_sound_timer);
+		break;
+	case EMULATOR_OP_LD_B:
+	case EMULATOR_OP_LD_MEM_VX: {
+		const uint8_t count = d->op == EMULATOR_OP_LD_B ? 3 : x + 1;
+		for (uint8_t j=0; j<count; j++) {
+			const uint16_t addr = emulator->_i + j;
+			push(trace, pc, opcode, TRACE_MEM | (j > 0 ? TRACE_CONTINUE : 0), emulator->_memory[addr], addr);
+		}
+		break;
+	}
+	case EMULATOR_OP_LD_RPL_VX:
+		for (uint8_t j=0; j<=x; j++) {
+			push(trace, pc, opcode, TRACE_RPL | (j > 0 ? TRACE_CONTINUE : 0), j, emulator->_rpl[j]);
+		}
+		break;
+	case EMULATOR_OP_LD_VX_MEM:
+	case EMULATOR_OP_LD_VX_RPL:
+		for (uint8_t j=0; j<=x; j++) {
+			push(trace, pc, opcode, TRACE_V | (j > 0 ? TRACE_CONTINUE : 0), j, emulator->_v[j]);
+		}
+		break;
+	default:
+		push(trace, pc, opcode, TRACE_EXEC, 0, 0);
+		break;
+	}
+
+	if (idle > 0) {
+		push(trace, pc, opcode, TRACE_IDLE | TRACE_CONTINUE, 0, idle);
+	}
+}
+
+void trace_fault(struct trace* trace, uint16_t pc, uint16_t opcode) {
+	push(trace, pc, opcode, TRACE_FAULT, 0, 0);
+}
+
+void trace_frame(struct trace* trace, const struct emulator* emulator) {
+	push(trace, emulator->_pc, 0, TRACE_FRAME, emulator->_delay_timer, emulator->keys);
+}
+
+int trace_read_header(FILE* in) {
+	struct trace_header header;
+	if (fread(&header, sizeof(header), 1, in) != 1) {
+		return 1;
+	}
+
+	return memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || header.version != TRACE_VERSION ||
+		header.record_size != sizeof(struct trace_record) ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "emulator.h"
+
+// Trace binário da execução (só com TRACE=1). O interpretador escreve num buffer circular sem
+// locks e uma thread separada grava no arquivo em blocos grandes, então o custo por instrução é
+// o de montar um registro de 8 bytes.
+//
+// O arquivo é um struct trace_header seguido de struct trace_record, na ordem de bytes da
+// máquina que gravou. Cada instrução gera um registro com o PC, o opcode e a primeira mudança que
+// ela fez; as outras mudanças (VF, os bytes do Fx55, ...) vêm logo depois com TRACE_CONTINUE.
+
+#define TRACE_MAGIC "C8TRACE"
+#define TRACE_VERSION 2
+
+struct trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size; // sizeof(struct trace_record)
+};
+
+enum trace_kind {
+	TRACE_EXEC,  // Sem mudança em registradores ou memória (saltos, pulos, CLS...)
+	TRACE_V,     // V[index] = value
+	TRACE_I,     // I = value
+	TRACE_MEM,   // memory[value] = index
+	TRACE_TIMER, // index 0: delay timer, 1: sound timer = value
+	TRACE_IDLE,  // O laço ocioso pulou value ciclos até o fim do quadro
+	TRACE_FAULT, // A instrução falhou e não mudou nada
+	TRACE_FRAME, // Fim do quadro (fora de qualquer instrução): index = delay timer, value = teclas
+	TRACE_STACK, // SP = index; value = o endereço que o CALL empilhou ou o RET desempilhou
+	TRACE_RPL,   // RPL[index] = value (Fx75)
+
+	// Marca os registros que continuam a instrução anterior
+	TRACE_CONTINUE = 0x80,
+};
+
+struct trace_record {
+	uint16_t pc;
+	uint16_t opcode;
+	uint8_t kind;
+	uint8_t index;
+	uint16_t value;
+};
+
+struct trace;
+
+// Grava o cabeçalho em out e começa a thread de escrita. out continua sendo de quem chamou, e só
+// pode ser fechado depois do trace_destroy. Retorna NULL se faltar memória ou a thread não subir.
+// Ligue com emulator->_trace = trace.
+struct trace* trace_create(FILE* out);
+
+// Espera a thread gravar tudo e a encerra. Retorna 1 se alguma escrita falhou.
+int trace_destroy(struct trace* trace);
+
+// Espera a thread gravar o que já foi registrado, pra quando o programa vai sair de repente.
+void trace_flush(struct trace* trace);
+
+// Chamados pelo interpretador depois de cada instrução. pc e opcode são os de antes da execução e
+// idle é quantos ciclos o laço ocioso pulou (0 se nenhum).
+void trace_step(struct trace* trace, const struct emulator* emulator, uint16_t pc, uint16_t opcode,
+	const struct emulator_decoded* d, size_t idle);
+void trace_fault(struct trace* trace, uint16_t pc, uint16_t opcode);
+
+// Chamado pelo emulator_tick depois dos timers.
+void trace_frame(struct trace* trace, const struct emulator* emulator);
+
+// Lê e confere o cabeçalho. Retorna 1 se in não for um trace desta versão.
+int trace_read_header(FILE* in);
+
+#endif
@@ -0,0 +1,431 @@
+/*
+	Copyright (C) 2025 filipemd
+
+	This file is part of C8EMU.
+
+	C8EMU is free software: you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation, either version 3
+	of the License, or (at your option) any later version.
+
+	C8EMU is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with C8EMU. If not,
+	see <https://www.gnu.org/licenses/>.
+*/
+
+// Acha a primeira instrução em que duas execuções divergem. Compara dois traces gravados com
+// --trace (de builds diferentes, por exemplo ENGINE=switch e ENGINE=threaded), ou roda a mesma ROM
+// duas vezes lado a lado: uma com o núcleo compilado (JIT incluído) e outra com o emulator_cycle,
+// uma instrução por vez, que é a referência.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emulator.h"
+#include "input_script.h"
+#include "trace.h"
+
+#ifdef EMULATOR_JIT
+#define ENGINE "jit"
+#elif defined(EMULATOR_THREADED)
+#define ENGINE "threaded"
+#else
+#define ENGINE "switch"
+#endif
+
+#define DEFAULT_FRAMES 600
+
+// Registros lidos de cada arquivo por vez
+#define BLOCK_RECORDS (1 << 16)
+
+// Quantos bytes diferentes da memória o relatório lista
+#define MEMORY_DIFFS 8
+
+static inline void show_usage(const char* argv0) {
+	printf("%s <a.trace> <b.trace>\n", argv0);
+	printf("  compare two traces written with --trace and report the first instruction that differs\n");
+	printf("%s --run <rom_file> [options]\n", argv0);
+	printf("  run the ROM with the " ENGINE " engine and with emulator_cycle side by side\n");
+	printf("  --frames N            run N frames (default %d)\n", DEFAULT_FRAMES);
+	printf("  --cycles-per-frame N  instructions per frame, 1-255 (default 16)\n");
+	printf("  --seed N              seed for the random number generator (default 0)\n");
+	printf("  --input FILE          scripted input, as in c8emu-headless\n");
+}
+
+static uint64_t parse_number(const char* option, const char* text) {
+	char* end;
+	const unsigned long long value = strtoull(text, &end, 0);
+
+	if (*text == '\0' || *end != '\0' || *text == '-') {
+		fprintf(stderr, "Error: %s expects a non-negative number, got \"%s\".\n", option, text);
+		exit(EXIT_FAILURE);
+	}
+
+	return value;
+}
+
+/* --- Dois traces --- */
+
+static FILE* open_trace(const char* file) {
+	FILE* trace = fopen(file, "rb");
+	if (trace == NULL) {
+		perror("Failed to open trace");
+		exit(EXIT_FAILURE);
+	}
+	if (trace_read_header(trace) != 0) {
+		fprintf(stderr, "Error: %s is not a trace from this version of the emulator.\n", file);
+		exit(EXIT_FAILURE);
+	}
+	return trace;
+}
+
+static void print_record(const char* file, const struct trace_record* record) {
+	printf("  %s: pc=0x%03X opcode=%04X ", file, record->pc, record->opcode);
+
+	switch (record->kind & ~TRACE_CONTINUE) {
+	case TRACE_EXEC:
+		printf("(no change)\n");
+		break;
+	case TRACE_V:
+		printf("V%X=0x%02X\n", record->index, record->value);
+		break;
+	case TRACE_I:
+		printf("I=0x%03X\n", record->value);
+		break;
+	case TRACE_MEM:
+		printf("[0x%03X]=0x%02X\n", record->value, record->index);
+		break;
+	case TRACE_TIMER:
+		printf("%s=%u\n", record->index == 0 ? "DT" : "ST", record->value);
+		break;
+	case TRACE_IDLE:
+		printf("idle for %u cycles\n", record->value);
+		break;
+	case TRACE_FAULT:
+		printf("fault\n");
+		break;
+	case TRACE_FRAME:
+		printf("end of frame, DT=%u keys=%04X\n", record->index, record->value);
+		break;
+	case TRACE_STACK:
+		printf("SP=%u, %s 0x%03X\n", record->index, record->opcode == 0x00EE ? "popped" : "pushed",
+			record->value);
+		break;
+	case TRACE_RPL:
+		printf("R%X=0x%02X\n", record->index, record->value);
+		break;
+	default:
+		printf("unknown record kind %u\n", record->kind);
+		break;
+	}
+}
+
+// Primeiro registro diferente. Os blocos iguais (quase todos) saem no memcmp, que já é vetorizado.
+static size_t first_difference(const struct trace_record* a, const struct trace_record* b, size_t count) {
+	if (memcmp(a, b, count * sizeof(struct trace_record)) == 0) {
+		return count;
+	}
+
+	size_t j = 0;
+	while (memcmp(&a[j], &b[j], sizeof(struct trace_record)) == 0) {
+		j++;
+	}
+	return j;
+}
+
+static int compare_traces(const char* file_a, const char* file_b) {
+	static struct trace_record a[BLOCK_RECORDS];
+	static struct trace_record b[BLOCK_RECORDS];
+
+	FILE* trace_a = open_trace(file_a);
+	FILE* trace_b = open_trace(file_b);
+
+	uint64_t records = 0;
+	uint64_t instructions = 0;
+	uint64_t frames = 0;
+	int result = EXIT_SUCCESS;
+
+	for (;;) {
+		const size_t count_a = fread(a, sizeof(struct trace_record), BLOCK_RECORDS, trace_a);
+		const size_t count_b = fread(b, sizeof(struct trace_record), BLOCK_RECORDS, trace_b);
+		const size_t count = count_a < count_b ? count_a : count_b;
+
+		const size_t same = first_difference(a, b, count);
+
+		for (size_t j=0; j<same; j++) {
+			instructions += (a[j].kind & TRACE_CONTINUE) == 0 && a[j].kind != TRACE_FRAME;
+			frames += a[j].kind == TRACE_FRAME;
+		}
+		records += same;
+
+		if (same < count) {
+			printf("Traces diverge at record %llu (instruction %llu, frame %llu):\n",
+				(unsigned long long)records, (unsigned long long)instructions, (unsigned long long)frames);
+			print_record(file_a, &a[same]);
+			print_record(file_b, &b[same]);
+			result = EXIT_FAILURE;
+			break;
+		}
+
+		if (count_a != count_b) {
+			const char* shorter = count_a < count_b ? file_a : file_b;
+			const char* longer = count_a < count_b ? file_b : file_a;
+			printf("%s ends after %llu instructions (%llu frames); %s continues with:\n", shorter,
+				(unsigned long long)instructions, (unsigned long long)frames, longer);
+			print_record(longer, count_a < count_b ? &b[same] : &a[same]);
+			result = EXIT_FAILURE;
+			break;
+		}
+
+		if (count < BLOCK_RECORDS) {
+			printf("Traces match: %llu instructions, %llu frames.\n", (unsigned long long)instructions,
+				(unsigned long long)frames);
+			break;
+		}
+	}
+
+	if (ferror(trace_a) || ferror(trace_b)) {
+		perror("Failed to read trace");
+		result = EXIT_FAILURE;
+	}
+
+	fclose(trace_a);
+	fclose(trace_b);
+	return result;
+}
+
+/* --- Dois núcleos lado a lado --- */
+
+static struct emulator fast;
+static struct emulator reference;
+
+// Imprime os campos que diferem
+static void print_differences(const struct emulator_snapshot* a, const struct emulator_snapshot* b) {
+	if (a->pc != b->pc) {
+		printf("  pc: 0x%03X vs 0x%03X\n", a->pc, b->pc);
+	}
+	for (uint8_t r=0; r<16; r++) {
+		if (a->v[r] != b->v[r]) {
+			printf("  V%X: 0x%02X vs 0x%02X\n", r, a->v[r], b->v[r]);
+		}
+	}
+	for (uint8_t r=0; r<16; r++) {
+		if (a->rpl[r] != b->rpl[r]) {
+			printf("  RPL%X: 0x%02X vs 0x%02X\n", r, a->rpl[r], b->rpl[r]);
+		}
+	}
+	if (a->i != b->i) {
+		printf("  I: 0x%03X vs 0x%03X\n", a->i, b->i);
+	}
+	if (a->delay_timer != b->delay_timer) {
+		printf("  delay timer: %u vs %u\n", a->delay_timer, b->delay_timer);
+	}
+	if (a->sound_timer != b->sound_timer) {
+		printf("  sound timer: %u vs %u\n", a->sound_timer, b->sound_timer);
+	}
+	if (a->sp != b->sp) {
+		printf("  sp: %u vs %u\n", a->sp, b->sp);
+	}
+	for (uint8_t s=0; s<STACK_SIZE; s++) {
+		if (a->stack[s] != b->stack[s]) {
+			printf("  stack[%u]: 0x%03X vs 0x%03X\n", s, a->stack[s], b->stack[s]);
+		}
+	}
+	if (a->hires != b->hires) {
+		printf("  resolution: %s vs %s\n", a->hires ? "128x64" : "64x32", b->hires ? "128x64" : "64x32");
+	}
+	for (uint8_t y=0; y<EMULATOR_HIRES_HEIGHT; y++) {
+		if (a->screen[y][0] != b->screen[y][0] || a->screen[y][1] != b->screen[y][1]) {
+			printf("  screen row %u: %016llx%016llx vs %016llx%016llx\n", y,
+				(unsigned long long)a->screen[y][0], (unsigned long long)a->screen[y][1],
+				(unsigned long long)b->screen[y][0], (unsigned long long)b->screen[y][1]);
+		}
+	}
+	int shown = 0;
+	for (uint16_t addr=0; addr<MEMORY_SIZE && shown<MEMORY_DIFFS; addr++) {
+		if (a->memory[addr] != b->memory[addr]) {
+			printf("  memory[0x%03X]: 0x%02X vs 0x%02X\n", addr, a->memory[addr], b->memory[addr]);
+			shown++;
+		}
+	}
+	if (memcmp(a->rng, b->rng, sizeof(a->rng)) != 0) {
+		printf("  random number generator state\n");
+	}
+	if (a->draw_flag != b->draw_flag || a->beep_flag != b->beep_flag) {
+		printf("  draw/beep flags: %d/%d vs %d/%d\n", a->draw_flag, a->beep_flag, b->draw_flag, b->beep_flag);
+	}
+}
+
+// Roda count instruções nos dois. Retorna se cada um falhou.
+static void run_both(size_t count, int* fast_fault, int* reference_fault) {
+	*fast_fault = emulator_run(&fast, count);
+
+	*reference_fault = 0;
+	for (size_t j=0; j<count && *reference_fault==0; j++) {
+		*reference_fault = emulator_cycle(&reference);
+	}
+}
+
+// O quadro que começou em start divergiu: refaz com cada vez mais instruções até achar a primeira
+// que deixa os dois diferentes. Um quadro tem no máximo 255 instruções, então não vale bissecção.
+static void locate(const struct emulator_snapshot* start, uint64_t frame) {
+	static struct emulator_snapshot a;
+	static struct emulator_snapshot b;
+
+	const uint8_t cycles_per_frame = start->cycles_per_frame;
+
+	for (size_t count=1; count<=cycles_per_frame; count++) {
+		emulator_restore(&fast, start);
+		emulator_restore(&reference, start);
+
+		// O PC da instrução que vai rodar por último
+		for (size_t j=0; j+1<count; j++) {
+			emulator_cycle(&reference);
+		}
+		const uint16_t pc = reference._pc;
+		const uint16_t opcode = reference._memory[pc] << 8 | reference._memory[(pc + 1) % MEMORY_SIZE];
+		emulator_restore(&reference, start);
+
+		int fast_fault, reference_fault;
+		run_both(count, &fast_fault, &reference_fault);
+
+		emulator_snapshot(&fast, &a);
+		emulator_snapshot(&reference, &b);
+		if (fast_fault != reference_fault || fast.fault.kind != reference.fault.kind || memcmp(&a, &b, sizeof(a)) != 0) {
+			printf("Engines diverge at instruction %zu of frame %llu (cycle %llu), pc=0x%03X opcode=%04X.\n",
+				count, (unsigned long long)frame,
+				(unsigned long long)(frame * cycles_per_frame + count), pc, opcode);
+			printf("  " ENGINE " vs emulator_cycle:\n");
+			if (fast_fault != reference_fault || fast.fault.kind != reference.fault.kind) {
+				printf("  fault: %s vs %s\n", emulator_fault_string(fast_fault ? fast.fault.kind : EMULATOR_FAULT_NONE),
+					emulator_fault_string(reference_fault ? reference.fault.kind : EMULATOR_FAULT_NONE));
+			}
+			print_differences(&a, &b);
+			return;
+		}
+	}
+
+	printf("Engines diverge at the end of frame %llu (timers), after the same instructions.\n",
+		(unsigned long long)frame);
+}
+
+static int compare_engines(int argc, char* argv[]) {
+	const char* rom = argv[2];
+	uint64_t frames = DEFAULT_FRAMES;
+	uint64_t seed = 0;
+	uint8_t cycles_per_frame = 0; // 0: o padrão do emulador
+	struct input_script script = { NULL, 0, 0 };
+
+	for (int arg=3; arg<argc; arg++) {
+		if (arg + 1 >= argc) {
+			fprintf(stderr, "Error: unknown option or missing value: %s\n", argv[arg]);
+			return EXIT_FAILURE;
+		}
+
+		const char* option = argv[arg];
+		const char* value = argv[++arg];
+
+		if (strcmp(option, "--frames") == 0) {
+			frames = parse_number(option, value);
+		} else if (strcmp(option, "--seed") == 0) {
+			seed = parse_number(option, value);
+		} else if (strcmp(option, "--cycles-per-frame") == 0) {
+			const uint64_t n = parse_number(option, value);
+			if (n == 0 || n > 255) {
+				fprintf(stderr, "Error: cycles per frame amount must be between 1-255.\n");
+				return EXIT_FAILURE;
+			}
+			cycles_per_frame = n;
+		} else if (strcmp(option, "--input") == 0) {
+			input_script_load(&script, value);
+		} else {
+			fprintf(stderr, "Error: unknown option: %s\n", option);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Um mapeamento só pras duas instâncias
+	struct emulator_rom image;
+	const int error = emulator_rom_map(&image, rom);
+	if (error != EMULATOR_OK) {
+		fprintf(stderr, "Error: %s: %s.\n", rom, emulator_error_string(error));
+		return EXIT_FAILURE;
+	}
+	emulator_init_from_buffer(&fast, image.data, image.size, seed);
+	emulator_init_from_buffer(&reference, image.data, image.size, seed);
+	emulator_rom_unmap(&image);
+	if (cycles_per_frame != 0) {
+		fast.cycles_per_frame = cycles_per_frame;
+		reference.cycles_per_frame = cycles_per_frame;
+	}
+
+	static struct emulator_snapshot start;
+	static struct emulator_snapshot a;
+	static struct emulator_snapshot b;
+
+	int result = EXIT_SUCCESS;
+	uint64_t frame;
+
+	for (frame=0; frame<frames; frame++) {
+		const uint16_t keys = input_script_keys(&script, frame, fast.keys);
+		fast.keys = keys;
+		reference.keys = keys;
+		fast.draw_flag = false;
+		reference.draw_flag = false;
+
+		emulator_snapshot(&fast, &start);
+
+		int fast_fault, reference_fault;
+		run_both(fast.cycles_per_frame, &fast_fault, &reference_fault);
+		if (fast_fault == 0 && reference_fault == 0) {
+			emulator_end_frame(&fast);
+			emulator_end_frame(&reference);
+		}
+
+		emulator_snapshot(&fast, &a);
+		emulator_snapshot(&reference, &b);
+		if (fast_fault != reference_fault || fast.fault.kind != reference.fault.kind || memcmp(&a, &b, sizeof(a)) != 0) {
+			locate(&start, frame);
+			result = EXIT_FAILURE;
+			break;
+		}
+
+		// Os dois falharam no mesmo lugar: concordam, mas não tem como seguir
+		if (fast_fault != 0) {
+			printf("Both engines fault at frame %llu: %s at pc=0x%03X.\n", (unsigned long long)frame,
+				emulator_fault_string(fast.fault.kind), fast.fault.pc);
+			break;
+		}
+	}
+
+	if (result == EXIT_SUCCESS) {
+		printf("Engines match: %llu frames, state hash %016llx.\n", (unsigned long long)frame,
+			(unsigned long long)emulator_state_hash(&fast));
+	}
+
+	input_script_free(&script);
+	emulator_quit(&fast);
+	emulator_quit(&reference);
+	return result;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc >= 3 && strcmp(argv[1], "--run") == 0) {
+		return compare_engines(argc, argv);
+	}
+
+	if (argc >= 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)) {
+		show_usage(argv[0]);
+		return EXIT_SUCCESS;
+	}
+	if (argc != 3) {
+		show_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	return compare_traces(argv[1], argv[2]);
+}